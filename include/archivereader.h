@@ -0,0 +1,66 @@
+#ifndef ARCHIVEREADER_H
+#define ARCHIVEREADER_H
+
+#include <QIODevice>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QUrl>
+
+struct ArchiveMember
+{
+    QString name;
+    qint64 offset = 0;
+    qint64 size = 0;
+};
+
+/**
+ * Index of the uncompressed members of store-mode ZIP and TAR archives.
+ *
+ * The index is built once per archive from the ZIP central directory or the
+ * TAR headers and cached until the archive changes on disk. Members are
+ * addressed with the archive's file URL and the member name as fragment.
+ */
+class ArchiveIndex
+{
+public:
+    static bool isArchive(const QString &filePath);
+    static QList<ArchiveMember> members(const QString &archivePath);
+    static bool findMember(const QString &archivePath, const QString &memberName, ArchiveMember &member);
+
+    static QUrl memberUrl(const QString &archivePath, const QString &memberName);
+    static bool splitMemberUrl(const QUrl &url, QString &archivePath, QString &memberName);
+
+private:
+    static QList<ArchiveMember> readZip(QFile &file);
+    static QList<ArchiveMember> readTar(QFile &file);
+};
+
+/**
+ * Read-only view of one archive member over a memory mapping of the archive,
+ * so the member is never extracted or buffered.
+ */
+class ArchiveMemberDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    ArchiveMemberDevice(const QString &archivePath, const ArchiveMember &member, QObject *parent = nullptr);
+    ~ArchiveMemberDevice();
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override { return false; }
+    qint64 size() const override { return m_member.size; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QFile m_file;
+    ArchiveMember m_member;
+    const uchar *m_data;
+};
+
+#endif // ARCHIVEREADER_H
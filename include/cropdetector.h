@@ -0,0 +1,109 @@
+#ifndef CROPDETECTOR_H
+#define CROPDETECTOR_H
+
+#include <QObject>
+#include <QQmlEngine>
+#include <QPointer>
+#include <QMediaPlayer>
+#include <QVideoSink>
+#include <QVideoFrame>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QMutex>
+#include <QRect>
+#include <QRectF>
+#include <QSize>
+#include <QHash>
+#include <atomic>
+
+/**
+ * Finds the active picture area of letterboxed or pillarboxed video.
+ *
+ * A frame is taken from the sink at most every SAMPLE_INTERVAL_MS and scanned
+ * on the thread pool, the sink thread itself only checks the clock. The
+ * area is the union of what samples found lit, so dark scenes never shrink
+ * it, and it is published once enough samples agree. Results are kept per
+ * source for the rest of the session.
+ */
+class CropDetector : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(QVideoSink *videoSink READ videoSink WRITE setVideoSink NOTIFY videoSinkChanged)
+    Q_PROPERTY(QMediaPlayer *player READ player WRITE setPlayer NOTIFY playerChanged)
+    Q_PROPERTY(QRectF cropRect READ cropRect NOTIFY cropChanged)
+    Q_PROPERTY(QSize croppedSize READ croppedSize NOTIFY cropChanged)
+    Q_PROPERTY(bool hasCrop READ hasCrop NOTIFY cropChanged)
+
+public:
+    explicit CropDetector(QObject *parent = nullptr);
+    ~CropDetector();
+
+    bool isActive() const { return m_active; }
+    void setActive(bool active);
+    QVideoSink *videoSink() const { return m_videoSink; }
+    void setVideoSink(QVideoSink *sink);
+    QMediaPlayer *player() const { return m_player; }
+    void setPlayer(QMediaPlayer *player);
+
+    /**
+     * Active area relative to the frame, (0, 0, 1, 1) when nothing is cropped
+     */
+    QRectF cropRect() const;
+    QSize croppedSize() const;
+    bool hasCrop() const { return m_hasCrop; }
+
+signals:
+    void activeChanged();
+    void videoSinkChanged();
+    void playerChanged();
+    void cropChanged();
+
+private:
+    struct CacheEntry
+    {
+        QSize frameSize;
+        QRect area;
+        int samples = 0;
+    };
+
+    void connectSink();
+    void disconnectSink();
+    void onVideoFrame(const QVideoFrame &frame);
+    void applySample(quint32 generation, const QSize &frameSize, const QRect &area);
+    void onSourceChanged();
+    void publish();
+    void clearCrop();
+
+    static QRect scanFrame(QVideoFrame frame);
+
+    static constexpr qint64 SAMPLE_INTERVAL_MS = 500;
+    static constexpr int MIN_SAMPLES = 4;
+    static constexpr int MIN_CROP_PERCENT = 1;
+
+    bool m_active;
+    QPointer<QVideoSink> m_videoSink;
+    QPointer<QMediaPlayer> m_player;
+    QMetaObject::Connection m_frameConnection;
+
+    // Touched from the sink thread
+    QElapsedTimer m_clock;
+    std::atomic<qint64> m_nextSample;
+    std::atomic<quint32> m_generation;
+    std::atomic<bool> m_busy;
+    QMutex m_taskMutex;
+    QFuture<void> m_task;
+
+    QString m_source;
+    QSize m_frameSize;
+    QRect m_area;
+    int m_samples;
+    bool m_hasCrop;
+    QRect m_crop;
+
+    static QHash<QString, CacheEntry> s_cache;
+};
+
+#endif // CROPDETECTOR_H
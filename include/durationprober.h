@@ -0,0 +1,76 @@
+#ifndef DURATIONPROBER_H
+#define DURATIONPROBER_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+/**
+ * Reads media durations straight from container headers.
+ *
+ * Only the few boxes, elements or frames that carry the duration are read
+ * (MP4 mvhd, Matroska Info, FLAC STREAMINFO, MP3 Xing/VBRI, WAV, AVI, ASF and
+ * Ogg), so a whole playlist is probed on the thread pool in about the time it
+ * takes to open each file. Results are cached on disk until a file changes.
+ */
+class DurationProber : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DurationProber(QObject *parent = nullptr);
+    ~DurationProber();
+
+    /**
+     * Probes the entries without a cached duration, cancelling any previous run.
+     * Entries are local paths or archive member URLs.
+     */
+    void probe(const QStringList &entries);
+
+    /**
+     * @return the duration in ms, or -1 when unknown or not probed yet
+     */
+    qint64 duration(const QString &entry) const;
+
+    static qint64 readDuration(const QString &entry);
+    static qint64 readDuration(QIODevice &device);
+
+signals:
+    void durationsChanged();
+
+private:
+    struct Entry
+    {
+        qint64 size = -1;
+        qint64 modified = -1;
+        qint64 duration = -1;
+    };
+
+    struct Probe
+    {
+        QString entry;
+        Entry result;
+        bool changed = false;
+    };
+
+    void onResultsReady(int begin, int end);
+    void onFinished();
+    void loadCache();
+    void saveCache() const;
+
+    static Entry fileStamp(const QString &entry);
+    static QString cachePath();
+
+    QThreadPool m_pool;
+    QFutureWatcher<Probe> m_watcher;
+    QTimer m_notifyTimer;
+    QHash<QString, Entry> m_cache;
+    bool m_dirty;
+};
+
+#endif // DURATIONPROBER_H
@@ -0,0 +1,91 @@
+#ifndef EPISODEMARKERS_H
+#define EPISODEMARKERS_H
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+
+/**
+ * Finds intros and end credits shared by the episodes of a playlist.
+ *
+ * The audio of every episode is decoded once on a low priority pool, and the
+ * first and last minutes are reduced to one 24-bit chroma hash per 93 ms.
+ * Once the duration is known the tail window is anchored to it, frames in
+ * between are not hashed and decoding stops when the tail is filled.
+ * Hashes of neighbouring episodes are then aligned to find the longest run
+ * they have in common. Hashes and the resulting ranges are stored on disk, so
+ * known episodes are never decoded again.
+ */
+class EpisodeMarkers : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Markers
+    {
+        qint64 introStart = -1;
+        qint64 introEnd = -1;
+        qint64 creditsStart = -1;
+        qint64 creditsEnd = -1;
+    };
+
+    struct Fingerprint
+    {
+        QString filePath;
+        qint64 size = -1;
+        qint64 modified = -1;
+        qint64 durationMs = 0;
+        QList<quint32> head;
+        QList<quint32> tail;
+    };
+
+    explicit EpisodeMarkers(QObject *parent = nullptr);
+    ~EpisodeMarkers();
+
+    /**
+     * Analyzes the episodes that have no markers yet, cancelling any previous run
+     */
+    void analyze(const QStringList &filePaths);
+    Markers markers(const QString &filePath) const;
+
+signals:
+    void markersChanged();
+
+private:
+    struct Entry
+    {
+        qint64 size = -1;
+        qint64 modified = -1;
+        Markers markers;
+    };
+
+    void onFingerprintsReady();
+    void onMatchingReady();
+    void cancel();
+    void loadMarkers();
+    void saveMarkers() const;
+    bool isKnown(const QString &filePath) const;
+
+    static Fingerprint computeFingerprint(const QString &filePath, const std::atomic<bool> &cancelled);
+    static QHash<QString, Markers> matchEpisodes(const QStringList &filePaths, const QList<Fingerprint> &computed);
+    static bool loadFingerprint(const QString &filePath, Fingerprint &fingerprint);
+    static void saveFingerprint(const Fingerprint &fingerprint);
+    static QString fingerprintPath(const QString &filePath);
+    static QString markersPath();
+
+    QThreadPool m_pool;
+    QFutureWatcher<Fingerprint> m_fingerprintWatcher;
+    QFutureWatcher<QHash<QString, Markers>> m_matchWatcher;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+    QStringList m_pending;
+    QStringList m_lastRequest;
+    QHash<QString, Entry> m_entries;
+};
+
+#endif // EPISODEMARKERS_H
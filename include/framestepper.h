@@ -0,0 +1,83 @@
+#ifndef FRAMESTEPPER_H
+#define FRAMESTEPPER_H
+
+#include <QObject>
+#include <QQmlEngine>
+#include <QPointer>
+#include <QMediaPlayer>
+#include <QVideoSink>
+#include <QVideoFrame>
+#include <deque>
+
+/**
+ * Single frame stepping for a paused player.
+ *
+ * Frames the sink shows during playback are kept in a ring bounded by
+ * memoryLimit, so stepping back inside it just puts an older frame back
+ * into the sink instead of seeking and decoding again from the previous
+ * keyframe. Stepping past either end of the ring seeks by one frame.
+ */
+class FrameStepper : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(QVideoSink *videoSink READ videoSink WRITE setVideoSink NOTIFY videoSinkChanged)
+    Q_PROPERTY(QMediaPlayer *player READ player WRITE setPlayer NOTIFY playerChanged)
+    Q_PROPERTY(int memoryLimit READ memoryLimit WRITE setMemoryLimit NOTIFY memoryLimitChanged)
+
+public:
+    explicit FrameStepper(QObject *parent = nullptr);
+
+    bool isActive() const { return m_active; }
+    void setActive(bool active);
+    QVideoSink *videoSink() const { return m_videoSink; }
+    void setVideoSink(QVideoSink *sink);
+    QMediaPlayer *player() const { return m_player; }
+    void setPlayer(QMediaPlayer *player);
+
+    /**
+     * Ring size in MB, 0 keeps only the frame on screen and every step seeks
+     */
+    int memoryLimit() const { return m_memoryLimit; }
+    void setMemoryLimit(int megabytes);
+
+    Q_INVOKABLE void stepForward();
+    Q_INVOKABLE void stepBackward();
+
+signals:
+    void activeChanged();
+    void videoSinkChanged();
+    void playerChanged();
+    void memoryLimitChanged();
+
+private:
+    void connectSink();
+    void disconnectSink();
+    void onVideoFrame(const QVideoFrame &frame);
+    void onPlaybackStateChanged(QMediaPlayer::PlaybackState state);
+    void showFrame(int index);
+    void trim();
+    void clear();
+
+    static qint64 frameBytes(const QVideoFrame &frame);
+
+    // Hardware frames belong to the decoder's surface pool, holding many of them stalls decoding
+    static constexpr int MAX_HARDWARE_FRAMES = 12;
+
+    bool m_active;
+    int m_memoryLimit;
+    QPointer<QVideoSink> m_videoSink;
+    QPointer<QMediaPlayer> m_player;
+    QMetaObject::Connection m_frameConnection;
+
+    std::deque<QVideoFrame> m_frames;
+    qint64 m_bytes;
+    int m_hardwareFrames;
+    // Ring index shown in the sink, -1 while it shows what the player decoded last
+    int m_cursor;
+    bool m_injecting;
+};
+
+#endif // FRAMESTEPPER_H
@@ -0,0 +1,35 @@
+#ifndef LATENCYFILEDEVICE_H
+#define LATENCYFILEDEVICE_H
+
+#include <QIODevice>
+#include <QFile>
+
+/**
+ * Local file that behaves like high-latency storage: every read waits a fixed
+ * latency and is optionally throttled to a bandwidth. Used to reproduce
+ * network share stutter on a local disk.
+ */
+class LatencyFileDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    LatencyFileDevice(const QString &fileName, int latencyMs, qint64 bytesPerSecond = 0, QObject *parent = nullptr);
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override { return false; }
+    qint64 size() const override { return m_file.size(); }
+    bool seek(qint64 pos) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QFile m_file;
+    int m_latencyMs;
+    qint64 m_bytesPerSecond;
+};
+
+#endif // LATENCYFILEDEVICE_H
@@ -20,10 +20,16 @@
 #include <QMediaPlayer>
 #include <QAudioOutput>
 #include <QTimer>
-#include <QSettings>
-#include <Windows.h>
+#include <QPointer>
+#include <QFutureWatcher>
 #include "windowspowereventfilter.h"
 #include "singleinstanceserver.h"
+#include "shuffleorder.h"
+#include "playlistsorter.h"
+#include "playbackstats.h"
+#include "episodemarkers.h"
+#include "durationprober.h"
+#include "quickopenindex.h"
 
 class CoverArtImageProvider : public QQuickImageProvider
 {
@@ -47,6 +53,7 @@ class MediaController : public QObject
     Q_PROPERTY(bool hasPrevious READ hasPrevious NOTIFY playlistChanged)
     Q_PROPERTY(int currentIndex READ getCurrentIndex NOTIFY playlistChanged)
     Q_PROPERTY(int playlistSize READ getPlaylistSize NOTIFY playlistChanged)
+    Q_PROPERTY(QStringList playlist READ getPlaylist NOTIFY playlistChanged)
     Q_PROPERTY(QString currentTitle READ getCurrentTitle NOTIFY metadataChanged)
     Q_PROPERTY(QString currentArtist READ getCurrentArtist NOTIFY metadataChanged)
     Q_PROPERTY(QString currentAlbum READ getCurrentAlbum NOTIFY metadataChanged)
@@ -55,6 +62,18 @@ class MediaController : public QObject
     Q_PROPERTY(QVariantList subtitleTracks READ getSubtitleTracks NOTIFY tracksChanged)
     Q_PROPERTY(int activeAudioTrack READ getActiveAudioTrack WRITE setActiveAudioTrack NOTIFY tracksChanged)
     Q_PROPERTY(int activeSubtitleTrack READ getActiveSubtitleTrack WRITE setActiveSubtitleTrack NOTIFY tracksChanged)
+    Q_PROPERTY(bool shuffle READ shuffle WRITE setShuffle NOTIFY playbackOrderChanged)
+    Q_PROPERTY(RepeatMode repeatMode READ repeatMode WRITE setRepeatMode NOTIFY playbackOrderChanged)
+    Q_PROPERTY(SortOrder sortOrder READ sortOrder WRITE setSortOrder NOTIFY playbackOrderChanged)
+    Q_PROPERTY(ReadAheadMode readAheadMode READ readAheadMode WRITE setReadAheadMode NOTIFY readAheadModeChanged)
+    Q_PROPERTY(bool detectEpisodeMarkers READ detectEpisodeMarkers WRITE setDetectEpisodeMarkers NOTIFY detectEpisodeMarkersChanged)
+    Q_PROPERTY(qint64 introStart READ introStart NOTIFY markersChanged)
+    Q_PROPERTY(qint64 introEnd READ introEnd NOTIFY markersChanged)
+    Q_PROPERTY(qint64 creditsStart READ creditsStart NOTIFY markersChanged)
+    Q_PROPERTY(qint64 creditsEnd READ creditsEnd NOTIFY markersChanged)
+    Q_PROPERTY(qint64 playlistDuration READ playlistDuration NOTIFY playlistDurationChanged)
+    Q_PROPERTY(qint64 upcomingDuration READ upcomingDuration NOTIFY playlistDurationChanged)
+    Q_PROPERTY(bool playlistDurationComplete READ playlistDurationComplete NOTIFY playlistDurationChanged)
 
 public:
     static MediaController* create(QQmlEngine *qmlEngine, QJSEngine *jsEngine);
@@ -66,6 +85,29 @@ public:
     };
     Q_ENUM(CursorState)
 
+    enum RepeatMode {
+        RepeatOff,
+        RepeatAll,
+        RepeatOne
+    };
+    Q_ENUM(RepeatMode)
+
+    // QML name of PlaylistSorter::Order, so the two can not drift apart
+    enum SortOrder {
+        SortByName = PlaylistSorter::ByName,
+        SortByModified = PlaylistSorter::ByModified,
+        SortBySize = PlaylistSorter::BySize,
+        SortByTrackNumber = PlaylistSorter::ByTrackNumber
+    };
+    Q_ENUM(SortOrder)
+
+    enum ReadAheadMode {
+        ReadAheadNetwork,
+        ReadAheadAlways,
+        ReadAheadOff
+    };
+    Q_ENUM(ReadAheadMode)
+
     Q_INVOKABLE void setCursorState(CursorState state);
     Q_INVOKABLE QString getInitialMediaPath() const;
     Q_INVOKABLE QString formatDuration(qint64 duration);
@@ -83,6 +125,10 @@ public:
     Q_INVOKABLE void openInExplorer(const QString &filePath);
     Q_INVOKABLE void updateTracks(const QVariantList &audioTracks, const QVariantList &subtitleTracks, int activeAudio, int activeSubtitle);
     Q_INVOKABLE void selectDefaultTracks();
+    Q_INVOKABLE void openSource(QMediaPlayer *player, const QString &source);
+    Q_INVOKABLE QString resolveSource(const QString &source);
+    Q_INVOKABLE void setPlaybackStats(PlaybackStats *stats);
+    Q_INVOKABLE QVariantList searchFiles(const QString &query);
 
     void setInstanceServer(SingleInstanceServer *server);
 
@@ -90,6 +136,7 @@ public:
     bool hasPrevious() const;
     int getCurrentIndex() const;
     int getPlaylistSize() const;
+    QStringList getPlaylist() const;
 
     QString getCurrentTitle() const { return m_currentTitle; }
     QString getCurrentArtist() const { return m_currentArtist; }
@@ -103,12 +150,39 @@ public:
     void setActiveAudioTrack(int track);
     void setActiveSubtitleTrack(int track);
 
+    bool shuffle() const { return m_shuffle; }
+    void setShuffle(bool shuffle);
+    RepeatMode repeatMode() const { return m_repeatMode; }
+    void setRepeatMode(RepeatMode mode);
+    SortOrder sortOrder() const { return m_sortOrder; }
+    void setSortOrder(SortOrder order);
+    ReadAheadMode readAheadMode() const { return m_readAheadMode; }
+    void setReadAheadMode(ReadAheadMode mode);
+    bool detectEpisodeMarkers() const { return m_detectEpisodeMarkers; }
+    void setDetectEpisodeMarkers(bool enabled);
+
+    // Shared intro and credits of the current episode in ms, -1 when unknown
+    qint64 introStart() const { return m_currentMarkers.introStart; }
+    qint64 introEnd() const { return m_currentMarkers.introEnd; }
+    qint64 creditsStart() const { return m_currentMarkers.creditsStart; }
+    qint64 creditsEnd() const { return m_currentMarkers.creditsEnd; }
+
+    // Sums over the entries whose duration is known, upcoming follows the playback order
+    qint64 playlistDuration() const { return m_playlistDuration; }
+    qint64 upcomingDuration() const { return m_upcomingDuration; }
+    bool playlistDurationComplete() const { return m_playlistDurationComplete; }
+
 signals:
     void playlistChanged();
+    void playbackOrderChanged();
+    void readAheadModeChanged();
+    void detectEpisodeMarkersChanged();
+    void markersChanged();
+    void playlistDurationChanged();
     void metadataChanged();
     void systemResumed();
     void tracksChanged();
-    void trackSelectionRequested(const QString &audioLanguage, const QString &subtitleLanguage, bool autoSelectSubtitles);
+    void folderVolumeRequested(qreal volume);
     void fileReceivedFromAnotherInstance(const QString &filePath);
 
 private slots:
@@ -124,8 +198,45 @@ private:
     SingleInstanceServer* m_instanceServer;
 
     QStringList m_playlist;
+    QString m_playlistDirectory;
     int m_currentIndex;
 
+    bool m_shuffle = false;
+    RepeatMode m_repeatMode = RepeatOff;
+    SortOrder m_sortOrder = SortByName;
+    PlaylistSorter m_playlistSorter;
+
+    // Background listing of the current folder, see buildPlaylistFromFile
+    QFutureWatcher<QStringList> m_rescanWatcher;
+    QString m_rescanDirectory;
+    bool m_rescanQueued = false;
+
+    // Last listed archive, opening one resolves its first member and then builds the playlist from it
+    struct ArchiveListing {
+        QString path;
+        qint64 modified = -1;
+        SortOrder order = SortByName;
+        QStringList members;
+    };
+    ArchiveListing m_archiveListing;
+
+    ReadAheadMode m_readAheadMode = ReadAheadNetwork;
+    QHash<QMediaPlayer*, QPointer<QIODevice>> m_sourceDevices;
+    QPointer<PlaybackStats> m_playbackStats;
+    bool m_detectEpisodeMarkers = false;
+    EpisodeMarkers m_episodeMarkers;
+    EpisodeMarkers::Markers m_currentMarkers;
+    DurationProber m_durationProber;
+    QuickOpenIndex m_quickOpenIndex;
+    static constexpr int QUICK_OPEN_RESULTS = 50;
+    qint64 m_playlistDuration = 0;
+    qint64 m_upcomingDuration = 0;
+    bool m_playlistDurationComplete = false;
+    ShuffleOrder m_shuffleOrder;
+    ShuffleOrder m_nextShuffleCycle;
+    int m_nextIndex = -1;
+    int m_previousIndex = -1;
+
     QMediaPlayer* m_metadataPlayer;
     QAudioOutput* m_metadataAudioOutput;
     QString m_currentTitle;
@@ -140,8 +251,27 @@ private:
 
     static CoverArtImageProvider* s_coverArtProvider;
 
-    QStringList getSupportedMediaFiles(const QDir &directory) const;
+    QStringList getSupportedMediaFiles(const QDir &directory);
+    QStringList getArchiveMediaMembers(const QString &archivePath);
+    QList<ArchiveMember> archiveMediaMembers(const QString &archivePath) const;
+    void applyPlaylist(const QStringList &playlist, const QString &directoryPath, bool isArchive, const QString &currentKey);
+    void rescanPlaylist();
+    void onRescanFinished();
+    void waitForRescan();
+    QString playlistKey(const QString &source) const;
+    QString entryUrl(const QString &entry) const;
     bool isMediaFile(const QString &fileName) const;
+    bool isVideoFile(const QString &fileName) const;
+    void setCurrentIndex(int index);
+    void resetShuffleOrder();
+    void updateNeighbours();
+    void analyzeEpisodes();
+    void updateMarkers();
+    void updatePlaylistDuration();
+    bool shouldReadAhead(const QString &localPath) const;
+    void setPlayerSource(QMediaPlayer *player, const QString &source, bool allowReadAhead);
+    QIODevice* createSourceDevice(const QUrl &url, bool allowReadAhead);
+    QIODevice* createReadAheadDevice(QIODevice *upstream);
     void extractMetadataFromFile(const QString &filePath);
     bool m_sleepPrevented = false;
     WindowsPowerEventFilter* m_powerEventFilter;
@@ -0,0 +1,109 @@
+#ifndef MEDIAEXPORTER_H
+#define MEDIAEXPORTER_H
+
+#include <QObject>
+#include <QQmlEngine>
+#include <QPointer>
+#include <QMediaPlayer>
+#include <QVideoSink>
+#include <QFutureWatcher>
+#include <QProcess>
+#include <QThreadPool>
+
+/**
+ * Snapshots of the current frame and A-B clips of the current file.
+ *
+ * A snapshot only takes a reference to the frame the sink shows on the GUI
+ * thread, converting and encoding it runs on a low priority worker so
+ * playback keeps its frame pacing. Clips are cut with ffmpeg stream copy,
+ * from the keyframe at or before A, so nothing is re-encoded; its progress
+ * output drives the progress property.
+ */
+class MediaExporter : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(QVideoSink *videoSink READ videoSink WRITE setVideoSink NOTIFY videoSinkChanged)
+    Q_PROPERTY(QMediaPlayer *player READ player WRITE setPlayer NOTIFY playerChanged)
+    Q_PROPERTY(qint64 clipStart READ clipStart NOTIFY clipChanged)
+    Q_PROPERTY(qint64 clipEnd READ clipEnd NOTIFY clipChanged)
+    Q_PROPERTY(bool canExportClip READ canExportClip NOTIFY clipChanged)
+    Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged)
+    Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
+
+public:
+    explicit MediaExporter(QObject *parent = nullptr);
+    ~MediaExporter();
+
+    QVideoSink *videoSink() const { return m_videoSink; }
+    void setVideoSink(QVideoSink *sink);
+    QMediaPlayer *player() const { return m_player; }
+    void setPlayer(QMediaPlayer *player);
+
+    qint64 clipStart() const { return m_clipStart; }
+    qint64 clipEnd() const { return m_clipEnd; }
+    bool canExportClip() const;
+    bool isBusy() const { return m_busy; }
+
+    /**
+     * 0 to 1, or -1 while the work gives no measure of how far it got
+     */
+    double progress() const { return m_progress; }
+
+    /**
+     * Saves the frame on screen to the Pictures folder, format is "png" or "jpg"
+     */
+    Q_INVOKABLE void saveSnapshot(const QString &format);
+
+    Q_INVOKABLE void markClipStart();
+    Q_INVOKABLE void markClipEnd();
+    Q_INVOKABLE void clearClip();
+
+    /**
+     * Writes the marked range to the Videos folder next to its siblings
+     */
+    Q_INVOKABLE void exportClip();
+    Q_INVOKABLE void cancel();
+
+signals:
+    void videoSinkChanged();
+    void playerChanged();
+    void clipChanged();
+    void busyChanged();
+    void progressChanged();
+    void exportFinished(const QString &filePath, const QString &error);
+
+private:
+    void onSnapshotDone();
+    void onProcessOutput();
+    void onProcessFinished(int exitCode, QProcess::ExitStatus status);
+    void onProcessError(QProcess::ProcessError error);
+    void setBusy(bool busy);
+    void setProgress(double progress);
+    void finish(const QString &filePath, const QString &error);
+    QString sourcePath(QString &error) const;
+
+    static QString outputPath(const QString &directory, const QString &baseName, const QString &suffix);
+    static QString timeTag(qint64 ms);
+    static QString findFfmpeg();
+
+    QPointer<QVideoSink> m_videoSink;
+    QPointer<QMediaPlayer> m_player;
+    qint64 m_clipStart;
+    qint64 m_clipEnd;
+    bool m_busy;
+    double m_progress;
+
+    QThreadPool m_pool;
+    QFutureWatcher<QString> m_snapshotWatcher;
+    QString m_snapshotPath;
+
+    QProcess m_process;
+    QString m_clipPath;
+    QByteArray m_processOutput;
+    qint64 m_clipLength;
+    bool m_cancelled;
+};
+
+#endif // MEDIAEXPORTER_H
@@ -0,0 +1,168 @@
+#ifndef PLAYBACKSTATS_H
+#define PLAYBACKSTATS_H
+
+#include <QObject>
+#include <QQmlEngine>
+#include <QPointer>
+#include <QMediaPlayer>
+#include <QVideoSink>
+#include <QVideoFrame>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVariantList>
+#include <array>
+#include <atomic>
+
+/**
+ * Collects frame timing statistics from a video sink while active.
+ *
+ * Frames are recorded on whatever thread the sink delivers them on, into fixed
+ * ring buffers and atomic counters, so nothing is allocated per frame. The
+ * published properties are refreshed from a timer on the GUI thread.
+ */
+class PlaybackStats : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(QVideoSink *videoSink READ videoSink WRITE setVideoSink NOTIFY videoSinkChanged)
+    Q_PROPERTY(QMediaPlayer *player READ player WRITE setPlayer NOTIFY playerChanged)
+    Q_PROPERTY(double effectiveFps READ effectiveFps NOTIFY statsChanged)
+    Q_PROPERTY(double nominalFps READ nominalFps NOTIFY statsChanged)
+    Q_PROPERTY(double jitterMs READ jitterMs NOTIFY statsChanged)
+    Q_PROPERTY(int droppedFrames READ droppedFrames NOTIFY statsChanged)
+    Q_PROPERTY(int lateFrames READ lateFrames NOTIFY statsChanged)
+    Q_PROPERTY(int totalFrames READ totalFrames NOTIFY statsChanged)
+    Q_PROPERTY(double meanDelayMs READ meanDelayMs NOTIFY statsChanged)
+    Q_PROPERTY(QVariantList delayHistogram READ delayHistogram NOTIFY statsChanged)
+    Q_PROPERTY(QVariantList delayHistogramLabels READ delayHistogramLabels CONSTANT)
+    Q_PROPERTY(qint64 bitrate READ bitrate NOTIFY statsChanged)
+    Q_PROPERTY(qint64 ioThroughput READ ioThroughput NOTIFY statsChanged)
+    Q_PROPERTY(int ioStalls READ ioStalls NOTIFY statsChanged)
+    Q_PROPERTY(double ioStallMs READ ioStallMs NOTIFY statsChanged)
+    Q_PROPERTY(double openLatencyMs READ openLatencyMs NOTIFY statsChanged)
+    Q_PROPERTY(double advanceLatencyMs READ advanceLatencyMs NOTIFY statsChanged)
+
+public:
+    explicit PlaybackStats(QObject *parent = nullptr);
+    ~PlaybackStats();
+
+    bool isActive() const { return m_active; }
+    void setActive(bool active);
+    QVideoSink *videoSink() const { return m_videoSink; }
+    void setVideoSink(QVideoSink *sink);
+    QMediaPlayer *player() const { return m_player; }
+    void setPlayer(QMediaPlayer *player);
+
+    double effectiveFps() const { return m_effectiveFps; }
+    double nominalFps() const { return m_nominalFps; }
+    double jitterMs() const { return m_jitterMs; }
+    int droppedFrames() const { return m_droppedFrames; }
+    int lateFrames() const { return m_lateFrames; }
+    int totalFrames() const { return m_totalFrames; }
+    double meanDelayMs() const { return m_meanDelayMs; }
+    QVariantList delayHistogram() const { return m_delayHistogram; }
+    QVariantList delayHistogramLabels() const;
+    qint64 bitrate() const { return m_bitrate; }
+    qint64 ioThroughput() const { return m_ioThroughput; }
+    int ioStalls() const { return m_ioStalls; }
+    double ioStallMs() const { return m_ioStallMs; }
+
+    /**
+     * Last source change to LoadedMedia and last automatic advance to the next file playing, -1 until measured
+     */
+    double openLatencyMs() const { return m_openLatencyMs; }
+    double advanceLatencyMs() const { return m_advanceLatencyMs; }
+
+    /**
+     * Called when the player moves on by itself. Times from the EndOfMedia that
+     * led to it, or from now when it happens before the end (skipped credits).
+     * Files opened by the user, or played again after a prompt, are not timed.
+     */
+    Q_INVOKABLE void markAutoAdvance();
+
+    /**
+     * Accounts bytes read and reads that waited on the media I/O layer, safe to call from any thread
+     */
+    void recordBytesRead(qint64 bytes);
+    void recordStall(qint64 durationUs);
+
+    Q_INVOKABLE void reset();
+
+signals:
+    void activeChanged();
+    void videoSinkChanged();
+    void playerChanged();
+    void statsChanged();
+
+private slots:
+    void publish();
+    void requestRebase();
+
+private:
+    void connectSink();
+    void disconnectSink();
+    void onVideoFrame(const QVideoFrame &frame);
+    void onSourceChanged(const QUrl &source);
+    void onMediaStatusChanged(QMediaPlayer::MediaStatus status);
+    void onPlaybackStateChanged(QMediaPlayer::PlaybackState state);
+    qint64 computeBitrate() const;
+
+    static constexpr int RING_SIZE = 256;
+    static constexpr int HISTOGRAM_BUCKETS = 8;
+    static constexpr int PUBLISH_INTERVAL_MS = 500;
+    static constexpr qint64 DISCONTINUITY_US = 1000000;
+    static constexpr qint64 JITTER_WINDOW_NS = 2000000000;
+
+    bool m_active;
+    QPointer<QVideoSink> m_videoSink;
+    QPointer<QMediaPlayer> m_player;
+    QMetaObject::Connection m_frameConnection;
+    QTimer m_publishTimer;
+    QElapsedTimer m_clock;
+
+    // Written by the sink thread only
+    std::array<std::atomic<qint64>, RING_SIZE> m_arrivals;
+    std::atomic<quint32> m_writeIndex;
+    std::array<std::atomic<quint32>, HISTOGRAM_BUCKETS> m_histogram;
+    std::atomic<quint32> m_frameCount;
+    std::atomic<quint32> m_dropped;
+    std::atomic<quint32> m_late;
+    std::atomic<qint64> m_delaySumUs;
+    std::atomic<quint32> m_delaySamples;
+    std::atomic<qint64> m_frameIntervalUs;
+    std::atomic<bool> m_rebase;
+    std::atomic<double> m_playbackRate;
+    qint64 m_lastPts;
+    qint64 m_baseArrival;
+    qint64 m_basePts;
+
+    std::atomic<qint64> m_bytesRead;
+    std::atomic<quint32> m_stallCount;
+    std::atomic<qint64> m_stallTimeUs;
+    qint64 m_lastBytesRead;
+    qint64 m_lastPublish;
+
+    double m_effectiveFps;
+    double m_nominalFps;
+    double m_jitterMs;
+    int m_droppedFrames;
+    int m_lateFrames;
+    int m_totalFrames;
+    double m_meanDelayMs;
+    QVariantList m_delayHistogram;
+    qint64 m_bitrate;
+    qint64 m_ioThroughput;
+    int m_ioStalls;
+    double m_ioStallMs;
+
+    // Not tied to the sink, transitions are timed whether or not the overlay is shown
+    qint64 m_openStarted;
+    qint64 m_endOfMedia;
+    qint64 m_advanceStarted;
+    double m_openLatencyMs;
+    double m_advanceLatencyMs;
+};
+
+#endif // PLAYBACKSTATS_H
@@ -0,0 +1,64 @@
+#ifndef PLAYLISTSORTER_H
+#define PLAYLISTSORTER_H
+
+#include "archivereader.h"
+#include <QDir>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QCollatorSortKey>
+#include <optional>
+#include <vector>
+
+/**
+ * Lists the media files of a folder, or the media members of an archive,
+ * in a chosen order.
+ *
+ * Sort keys (locale-aware natural collation keys, track numbers) are computed
+ * once per entry, in parallel, and cached until the file changes on disk, so
+ * sorting itself only compares precomputed keys.
+ */
+class PlaylistSorter
+{
+public:
+    // Exposed to QML as MediaController::SortOrder
+    enum Order {
+        ByName,
+        ByModified,
+        BySize,
+        ByTrackNumber
+    };
+
+    QStringList sortedMediaFiles(const QDir &directory, const QStringList &nameFilters, Order order);
+
+    /**
+     * Member URLs of the given archive members. Members carry the time of the
+     * archive itself, so ordering by date keeps name order.
+     */
+    QStringList sortedArchiveMembers(const QString &archivePath, const QList<ArchiveMember> &members, Order order);
+
+private:
+    struct Entry {
+        QString fileName;
+        qint64 size = 0;
+        qint64 modified = 0;
+        qint64 offset = -1; // Within the archive, for archive members
+        int trackNumber = -1;
+        bool trackNumberRead = false;
+        std::optional<QCollatorSortKey> nameKey;
+    };
+
+    void useContainer(const QString &path);
+    Entry cachedEntry(const QString &fileName, qint64 size, qint64 modified) const;
+    std::vector<const Entry *> sortEntries(std::vector<Entry> &entries, Order order);
+    void storeEntries(std::vector<Entry> &entries);
+    void computeKeys(const std::vector<Entry *> &pending, bool readTrackNumbers);
+
+    static const int PARALLEL_THRESHOLD = 256;
+
+    // Folder or archive the cached entries belong to
+    QString m_directory;
+    QHash<QString, Entry> m_cache;
+};
+
+#endif // PLAYLISTSORTER_H
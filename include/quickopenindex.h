@@ -0,0 +1,139 @@
+#ifndef QUICKOPENINDEX_H
+#define QUICKOPENINDEX_H
+
+#include <QObject>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+/**
+ * Trigram index over played files and the folders they were played from.
+ *
+ * The index lives in a memory mapped file: paths, per-trigram posting lists
+ * of path ids and a path hash table, so nothing is parsed or loaded at
+ * startup. The arrays are checked once on a worker before lookups use them.
+ * Entries added during the session are kept in a small in-memory delta that
+ * is merged into a new file in the background.
+ *
+ * A query only walks the posting lists of its rarest trigrams, the common
+ * ones are checked per candidate with a binary search, and only the best
+ * candidates by trigram hits get their text decoded for the final ranking.
+ */
+class QuickOpenIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result
+    {
+        QString path;
+        double score = 0;
+    };
+
+    explicit QuickOpenIndex(QObject *parent = nullptr);
+    ~QuickOpenIndex();
+
+    void addFiles(const QStringList &paths);
+    void markPlayed(const QString &path);
+    QList<Result> search(const QString &query, int limit) const;
+
+    // True until the index file has been checked, only added entries are found before that
+    bool isLoading() const { return m_validatePending; }
+
+private:
+    struct Header
+    {
+        quint32 magic;
+        quint32 version;
+        quint32 pathCount;
+        quint32 trigramCount;
+        quint32 hashSlots;
+        quint32 stringBytes;
+    };
+
+    // Base file arrays, valid while the file is mapped
+    struct Base
+    {
+        quint32 pathCount = 0;
+        quint32 trigramCount = 0;
+        quint32 hashSlots = 0;
+        const quint32 *played = nullptr;
+        const quint32 *stringOffsets = nullptr;
+        const quint32 *keys = nullptr;
+        const quint32 *postingOffsets = nullptr;
+        const quint32 *postings = nullptr;
+        const quint32 *slots = nullptr;
+        const char *strings = nullptr;
+    };
+
+    struct Snapshot
+    {
+        Base base;
+        QStringList addedPaths;
+        QList<quint32> addedPlayed;
+        QHash<quint32, QList<quint32>> addedPostings;
+        QHash<quint32, quint32> playedOverrides;
+    };
+
+    struct Postings
+    {
+        const quint32 *base = nullptr;
+        qsizetype baseSize = 0;
+        const QList<quint32> *added = nullptr;
+
+        qsizetype size() const { return baseSize + (added ? added->size() : 0); }
+        bool contains(quint32 id, quint32 baseCount) const;
+    };
+
+    void mapBase(bool validate);
+    void onValidated();
+    void unmapBase();
+    bool replaceBase();
+    void scheduleSave();
+    void save();
+    void onSaved();
+    qint64 findId(const QString &path) const;
+    quint32 add(const QString &path);
+    quint32 playedAt(quint32 id) const;
+    QString pathAt(quint32 id) const;
+    Postings postings(quint32 key) const;
+    quint32 count() const { return m_base.pathCount + quint32(m_addedPaths.size()); }
+
+    static bool isConsistent(const Base &base);
+    static bool writeIndex(const QString &filePath, const Snapshot &snapshot);
+    static QString indexText(const QString &path);
+    static QList<quint32> trigrams(const QString &text);
+    static quint32 pathHash(const QByteArray &utf8);
+    static QString indexPath();
+
+    static constexpr quint32 MAGIC = 0x58494f51;
+    static constexpr quint32 VERSION = 1;
+    static constexpr int SAVE_DELAY_MS = 5000;
+    static constexpr int MAX_RANKED = 1000;
+
+    QFile m_file;
+    uchar *m_map;
+    Base m_base;
+
+    QFutureWatcher<bool> m_validateWatcher;
+    Base m_validating;
+    bool m_validatePending;
+
+    QStringList m_addedPaths;
+    QList<quint32> m_addedPlayed;
+    QHash<QString, quint32> m_addedIds;
+    QHash<quint32, QList<quint32>> m_addedPostings;
+    QHash<quint32, quint32> m_playedOverrides;
+
+    QTimer m_saveTimer;
+    QFutureWatcher<bool> m_saveWatcher;
+    Snapshot m_saving;
+    bool m_savePending;
+    bool m_dirty;
+};
+
+#endif // QUICKOPENINDEX_H
@@ -0,0 +1,97 @@
+#ifndef READAHEADDEVICE_H
+#define READAHEADDEVICE_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <atomic>
+#include <memory>
+
+/**
+ * Read-only device that prefetches a wrapped device on its own I/O thread.
+ *
+ * Large reads are issued ahead of the consumer into a bounded ring buffer so
+ * that high-latency storage is hit with few big requests instead of many small
+ * synchronous ones. Seeking outside the buffered window restarts prefetching at
+ * the target, followed by a smaller chunk just before it for demuxers that
+ * step back after a seek.
+ */
+class ReadAheadDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Takes ownership of upstream, which must already be open for reading
+     */
+    explicit ReadAheadDevice(QIODevice *upstream, QObject *parent = nullptr);
+    ~ReadAheadDevice();
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override { return false; }
+    qint64 size() const override { return m_size; }
+    bool seek(qint64 pos) override;
+
+    quint32 stallCount() const { return m_stallCount.load(std::memory_order_relaxed); }
+    qint64 stallTimeUs() const { return m_stallTimeUs.load(std::memory_order_relaxed); }
+    qint64 bytesFetched() const { return m_bytesFetched.load(std::memory_order_relaxed); }
+    quint32 restartCount() const { return m_restartCount.load(std::memory_order_relaxed); }
+
+signals:
+    /**
+     * Emitted from the I/O thread after each completed upstream read
+     */
+    void bytesFetched(qint64 bytes);
+
+    /**
+     * Emitted from the reading thread when a read had to wait for the I/O thread
+     */
+    void stalled(qint64 durationUs);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    void run();
+    void stopWorker();
+    void restartAt(qint64 pos);
+    void discardFront(qint64 bytes);
+    void copyIntoRing(qint64 ringOffset, const char *data, qint64 length);
+    void copyFromRing(qint64 ringOffset, char *data, qint64 length) const;
+
+    static constexpr qint64 CHUNK_SIZE = 1024 * 1024;
+    static constexpr qint64 CAPACITY = 16 * CHUNK_SIZE;
+    static constexpr qint64 BACKLOG_SIZE = 2 * CHUNK_SIZE;
+    static constexpr qint64 BEHIND_SIZE = CHUNK_SIZE / 2;
+
+    std::unique_ptr<QIODevice> m_upstream;
+    QThread *m_worker;
+    qint64 m_size;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_dataAvailable;
+    QWaitCondition m_workAvailable;
+
+    // Guarded by m_mutex
+    QByteArray m_buffer;
+    QByteArray m_chunk;
+    qint64 m_head;
+    qint64 m_bufferStart;
+    qint64 m_bufferLength;
+    qint64 m_readPos;
+    qint64 m_behindPending;
+    quint64 m_generation;
+    bool m_error;
+    bool m_stop;
+
+    std::atomic<quint32> m_stallCount;
+    std::atomic<qint64> m_stallTimeUs;
+    std::atomic<qint64> m_bytesFetched;
+    std::atomic<quint32> m_restartCount;
+};
+
+#endif // READAHEADDEVICE_H
@@ -0,0 +1,40 @@
+#ifndef REALFFT_H
+#define REALFFT_H
+
+#include <vector>
+
+/**
+ * Power spectrum of a real signal of power-of-two length.
+ *
+ * The signal is packed into a complex sequence of half the length and run
+ * through an iterative radix-2 FFT over separate real and imaginary arrays.
+ * Twiddles are stored per stage so every butterfly loop walks contiguous
+ * memory, which is processed four lanes at a time with SSE where available.
+ */
+class RealFft
+{
+public:
+    explicit RealFft(int size);
+
+    int size() const { return m_size; }
+
+    /**
+     * Writes size / 2 power values, bin k covering k * sampleRate / size
+     */
+    void powerSpectrum(const float *input, float *power);
+
+private:
+    void transform();
+
+    int m_size;
+    int m_half;
+    std::vector<int> m_bitReverse;
+    std::vector<float> m_stageCos;
+    std::vector<float> m_stageSin;
+    std::vector<float> m_unpackCos;
+    std::vector<float> m_unpackSin;
+    std::vector<float> m_re;
+    std::vector<float> m_im;
+};
+
+#endif // REALFFT_H
@@ -0,0 +1,75 @@
+#ifndef SHUFFLEORDER_H
+#define SHUFFLEORDER_H
+
+#include <QtGlobal>
+#include <QHash>
+#include <QList>
+#include <QPair>
+
+/**
+ * Lazily evaluated shuffle over playlist indices.
+ *
+ * Positions in a power-of-two domain are mapped to indices with a keyed Feistel
+ * network, so the shuffled order is never materialized. Indices outside the
+ * playlist are skipped while walking, and the walk starts at the position of the
+ * index the cycle was started from, which makes the order circular around it.
+ */
+class ShuffleOrder
+{
+public:
+    ShuffleOrder();
+
+    void reset(int size, int startIndex, quint64 seed);
+    void clear();
+
+    /**
+     * Grows the playlist without reshuffling. Entries that land behind the
+     * furthest visited position are left for the next cycle so stepping back
+     * keeps returning exactly what was already played. When the domain
+     * runs out, the played part of the cycle is kept as an explicit prefix
+     * and the rest continues over a larger domain.
+     */
+    void grow(int newSize);
+
+    void visit(int index);
+
+    bool isValid() const { return m_size > 0; }
+    int size() const { return m_size; }
+    int startIndex() const;
+
+    /**
+     * @return the index following/preceding index in this cycle, or -1 at the cycle boundary
+     */
+    int next(int index) const;
+    int previous(int index) const;
+
+private:
+    quint64 permute(quint64 position) const;
+    quint64 invert(quint64 value) const;
+    quint64 roundFunction(quint64 half, int round) const;
+    quint64 distanceOf(int index) const;
+    int sizeAt(quint64 distance) const;
+    int valueAt(quint64 step) const;
+    QList<int> playedOrder() const;
+
+    static const int ROUNDS = 4;
+    static const int HEADROOM_BITS = 4;
+
+    int m_size;
+    int m_halfBits;
+    quint64 m_halfMask;
+    quint64 m_domainMask;
+    quint64 m_keys[ROUNDS];
+    quint64 m_origin;
+    quint64 m_maxVisited;
+    quint64 m_seed;
+
+    // (furthest visited distance, size) recorded each time the playlist grows
+    QList<QPair<quint64, int>> m_growth;
+
+    // Played indices carried over from a smaller domain, walked before the permutation
+    QList<int> m_prefix;
+    QHash<int, int> m_prefixPositions;
+};
+
+#endif // SHUFFLEORDER_H
@@ -0,0 +1,137 @@
+#ifndef SPECTRUMVISUALIZER_H
+#define SPECTRUMVISUALIZER_H
+
+#include <QObject>
+#include <QQuickItem>
+#include <QQmlEngine>
+#include <QPointer>
+#include <QMediaPlayer>
+#include <QAudioBuffer>
+#include <QAudioBufferOutput>
+#include <QColor>
+#include <QThread>
+#include <QElapsedTimer>
+#include <array>
+#include <vector>
+#include "realfft.h"
+#include "triplebuffer.h"
+
+struct SpectrumFrame
+{
+    static constexpr int MAX_BARS = 128;
+
+    std::array<float, MAX_BARS> levels = {};
+    int count = 0;
+};
+
+/**
+ * Turns decoded PCM into log-frequency band levels on a worker thread.
+ *
+ * Samples are downmixed into a history ring, and once enough new samples have
+ * arrived for the next analysis tick the latest Hann-windowed block is
+ * transformed and binned. Results go to the triple buffer without locking.
+ */
+class SpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SpectrumAnalyzer(TripleBuffer<SpectrumFrame> *output, QObject *parent = nullptr);
+
+public slots:
+    void processBuffer(const QAudioBuffer &buffer);
+    void setBarCount(int count);
+    void clear();
+
+signals:
+    void frameReady();
+
+private:
+    void appendSamples(const QAudioBuffer &buffer);
+    void analyze();
+    void updateBands();
+
+    static constexpr int FFT_SIZE = 2048;
+    static constexpr int ANALYSIS_RATE = 60;
+    static constexpr float MIN_FREQUENCY = 40.0f;
+    static constexpr float MAX_FREQUENCY = 16000.0f;
+    static constexpr float FLOOR_DB = -70.0f;
+
+    TripleBuffer<SpectrumFrame> *m_output;
+    RealFft m_fft;
+    std::vector<float> m_window;
+    std::vector<float> m_history;
+    std::vector<float> m_mono;
+    std::vector<float> m_windowed;
+    std::vector<float> m_power;
+    std::vector<int> m_bandEdges;
+    float m_powerScale;
+    int m_historyPos;
+    int m_pendingSamples;
+    int m_sampleRate;
+    int m_barCount;
+};
+
+/**
+ * Bar spectrum of whatever the player is currently outputting.
+ *
+ * Analysis runs at its own rate on a worker thread, the item only picks up the
+ * latest frame and eases towards it at the render rate, dropping back to silence
+ * when frames stop arriving.
+ */
+class SpectrumVisualizer : public QQuickItem
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(QMediaPlayer *player READ player WRITE setPlayer NOTIFY playerChanged)
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(int barCount READ barCount WRITE setBarCount NOTIFY barCountChanged)
+    Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged)
+
+public:
+    explicit SpectrumVisualizer(QQuickItem *parent = nullptr);
+    ~SpectrumVisualizer();
+
+    QMediaPlayer *player() const { return m_player; }
+    void setPlayer(QMediaPlayer *player);
+    bool isActive() const { return m_active; }
+    void setActive(bool active);
+    int barCount() const { return m_barCount; }
+    void setBarCount(int count);
+    QColor color() const { return m_color; }
+    void setColor(const QColor &color);
+
+signals:
+    void playerChanged();
+    void activeChanged();
+    void barCountChanged();
+    void colorChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+
+private:
+    void attach();
+    void detach();
+
+    static constexpr qint64 STALE_MS = 150;
+    static constexpr float RELEASE_MS = 120.0f;
+
+    QPointer<QMediaPlayer> m_player;
+    bool m_active;
+    int m_barCount;
+    QColor m_color;
+    QAudioBufferOutput *m_bufferOutput;
+    QThread m_thread;
+    SpectrumAnalyzer *m_analyzer;
+    TripleBuffer<SpectrumFrame> m_frames;
+
+    // Render thread only
+    std::array<float, SpectrumFrame::MAX_BARS> m_levels;
+    QElapsedTimer m_renderClock;
+    qint64 m_lastRender;
+    qint64 m_lastFrame;
+};
+
+#endif // SPECTRUMVISUALIZER_H
@@ -0,0 +1,96 @@
+#ifndef THUMBNAILPROVIDER_H
+#define THUMBNAILPROVIDER_H
+
+#include <QQuickAsyncImageProvider>
+#include <QQuickImageResponse>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QImage>
+#include <QSize>
+#include <atomic>
+#include <memory>
+
+class ThumbnailJob;
+
+struct ThumbnailState
+{
+    std::atomic<bool> cancelled = false;
+    std::atomic<bool> started = false;
+};
+
+/**
+ * Video frames and cover art for the folder browser, as image://thumbnails/<url>.
+ *
+ * Decoding runs on a small pool, newest request first, so the cells on screen
+ * are served before the ones scrolled past, and requests for delegates that
+ * were destroyed are dropped from the queue. Results, including files with
+ * nothing to show, are kept in a size capped disk cache, hits skip the pool
+ * entirely.
+ */
+class ThumbnailProvider : public QQuickAsyncImageProvider
+{
+public:
+    ThumbnailProvider();
+    ~ThumbnailProvider();
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+private:
+    static constexpr int MAX_DECODERS = 3;
+
+    QThreadPool m_pool;
+    int m_sequence;
+};
+
+class ThumbnailResponse : public QQuickImageResponse
+{
+    Q_OBJECT
+
+public:
+    ThumbnailResponse(QThreadPool *pool, const QString &source, const QSize &size, int priority);
+
+    QQuickTextureFactory *textureFactory() const override;
+    void cancel() override;
+
+private:
+    void onDone(const QImage &image);
+
+    QThreadPool *m_pool;
+    ThumbnailJob *m_job;
+    std::shared_ptr<ThumbnailState> m_state;
+    QImage m_image;
+};
+
+class ThumbnailJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    ThumbnailJob(const QString &source, const QSize &size, std::shared_ptr<ThumbnailState> state);
+
+    void run() override;
+
+    static QString cachePath(const QString &source, const QSize &size);
+    static bool loadCached(const QString &path, QImage &image);
+
+signals:
+    void done(const QImage &image);
+
+private:
+    /**
+     * @param conclusive set when the file itself has nothing to show, as opposed
+     * to a timeout or an error that may pass
+     */
+    QImage extract(bool &conclusive) const;
+
+    static void store(const QString &path, const QImage &image);
+
+    static constexpr qint64 CACHE_LIMIT = 256 * 1024 * 1024;
+    static constexpr int EXTRACT_TIMEOUT_MS = 10000;
+
+    QString m_source;
+    QSize m_size;
+    std::shared_ptr<ThumbnailState> m_state;
+};
+
+#endif // THUMBNAILPROVIDER_H
@@ -0,0 +1,51 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <array>
+#include <atomic>
+
+/**
+ * Single producer, single consumer hand-off of the latest value.
+ *
+ * The producer fills its back slot and swaps it with the shared middle slot,
+ * the consumer swaps its front slot with the middle one when it holds a fresh
+ * value. Neither side ever waits, and a slow consumer simply skips values.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : m_back(0), m_middle(1), m_front(2) {}
+
+    T &back() { return m_slots[m_back]; }
+
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    /**
+     * Moves to the latest published value if there is one, returns whether it did
+     */
+    bool update()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T &front() const { return m_slots[m_front]; }
+
+private:
+    static constexpr int FRESH = 4;
+    static constexpr int INDEX_MASK = 3;
+
+    std::array<T, 3> m_slots;
+    int m_back;
+    std::atomic<int> m_middle;
+    int m_front;
+};
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,170 @@
+#ifndef USERSETTINGS_H
+#define USERSETTINGS_H
+
+#include <QObject>
+#include <QQmlEngine>
+#include <QHash>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariant>
+
+/**
+ * Settings shared by C++ and QML.
+ *
+ * Everything is read once at startup into typed members, so a read is a
+ * plain getter and every setting has its own change signal. Changes are
+ * collected and written to QSettings on a background thread once they
+ * settle, and the last ones are flushed on exit.
+ *
+ * Folders can override the track languages and the volume. Profiles are
+ * kept in a hash keyed by normalized folder path, the one for the folder
+ * being played is looked up when a file is loaded.
+ */
+class UserSettings : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+
+    Q_PROPERTY(QString preferredAudioLanguage READ preferredAudioLanguage WRITE setPreferredAudioLanguage NOTIFY preferredAudioLanguageChanged)
+    Q_PROPERTY(QString preferredSubtitleLanguage READ preferredSubtitleLanguage WRITE setPreferredSubtitleLanguage NOTIFY preferredSubtitleLanguageChanged)
+    Q_PROPERTY(bool autoSelectSubtitles READ autoSelectSubtitles WRITE setAutoSelectSubtitles NOTIFY autoSelectSubtitlesChanged)
+    Q_PROPERTY(qreal uiOpacity READ uiOpacity WRITE setUiOpacity NOTIFY uiOpacityChanged)
+    Q_PROPERTY(bool floatingUi READ floatingUi WRITE setFloatingUi NOTIFY floatingUiChanged)
+    Q_PROPERTY(bool shuffle READ shuffle WRITE setShuffle NOTIFY shuffleChanged)
+    Q_PROPERTY(int repeatMode READ repeatMode WRITE setRepeatMode NOTIFY repeatModeChanged)
+    Q_PROPERTY(int playlistSortOrder READ playlistSortOrder WRITE setPlaylistSortOrder NOTIFY playlistSortOrderChanged)
+    Q_PROPERTY(int readAheadMode READ readAheadMode WRITE setReadAheadMode NOTIFY readAheadModeChanged)
+    Q_PROPERTY(bool cropBlackBars READ cropBlackBars WRITE setCropBlackBars NOTIFY cropBlackBarsChanged)
+    Q_PROPERTY(bool detectEpisodeMarkers READ detectEpisodeMarkers WRITE setDetectEpisodeMarkers NOTIFY detectEpisodeMarkersChanged)
+    Q_PROPERTY(bool skipCredits READ skipCredits WRITE setSkipCredits NOTIFY skipCreditsChanged)
+    Q_PROPERTY(int frameCacheSize READ frameCacheSize WRITE setFrameCacheSize NOTIFY frameCacheSizeChanged)
+    Q_PROPERTY(bool hasFolderProfile READ hasFolderProfile NOTIFY folderProfileChanged)
+    Q_PROPERTY(QString resolvedAudioLanguage READ resolvedAudioLanguage NOTIFY resolvedProfileChanged)
+    Q_PROPERTY(QString resolvedSubtitleLanguage READ resolvedSubtitleLanguage NOTIFY resolvedProfileChanged)
+    Q_PROPERTY(bool resolvedAutoSelectSubtitles READ resolvedAutoSelectSubtitles NOTIFY resolvedProfileChanged)
+
+public:
+    struct FolderProfile
+    {
+        QString audioLanguage;
+        QString subtitleLanguage;
+        int autoSelectSubtitles = -1;
+        qreal volume = -1;
+
+        bool isEmpty() const;
+        QVariantMap toMap() const;
+        static FolderProfile fromMap(const QVariantMap &map);
+    };
+
+    static UserSettings* create(QQmlEngine *qmlEngine, QJSEngine *jsEngine);
+    static UserSettings* instance();
+
+    QString preferredAudioLanguage() const { return m_preferredAudioLanguage; }
+    void setPreferredAudioLanguage(const QString &language);
+    QString preferredSubtitleLanguage() const { return m_preferredSubtitleLanguage; }
+    void setPreferredSubtitleLanguage(const QString &language);
+    bool autoSelectSubtitles() const { return m_autoSelectSubtitles; }
+    void setAutoSelectSubtitles(bool enabled);
+    qreal uiOpacity() const { return m_uiOpacity; }
+    void setUiOpacity(qreal opacity);
+    bool floatingUi() const { return m_floatingUi; }
+    void setFloatingUi(bool enabled);
+    bool shuffle() const { return m_shuffle; }
+    void setShuffle(bool enabled);
+    int repeatMode() const { return m_repeatMode; }
+    void setRepeatMode(int mode);
+    int playlistSortOrder() const { return m_playlistSortOrder; }
+    void setPlaylistSortOrder(int order);
+    int readAheadMode() const { return m_readAheadMode; }
+    void setReadAheadMode(int mode);
+    bool cropBlackBars() const { return m_cropBlackBars; }
+    void setCropBlackBars(bool enabled);
+    bool detectEpisodeMarkers() const { return m_detectEpisodeMarkers; }
+    void setDetectEpisodeMarkers(bool enabled);
+    bool skipCredits() const { return m_skipCredits; }
+    void setSkipCredits(bool enabled);
+    int frameCacheSize() const { return m_frameCacheSize; }
+    void setFrameCacheSize(int megabytes);
+
+    Q_INVOKABLE void resetPreferences();
+
+    /**
+     * Makes the folder of filePath the one the profile calls below apply to
+     */
+    void setCurrentFile(const QString &filePath);
+
+    /**
+     * Profile of the current folder with the track settings it does not
+     * override filled in from the global ones. Volume stays -1 where the
+     * folder has no value of its own.
+     */
+    FolderProfile resolvedProfile() const;
+    QString resolvedAudioLanguage() const { return resolvedProfile().audioLanguage; }
+    QString resolvedSubtitleLanguage() const { return resolvedProfile().subtitleLanguage; }
+    bool resolvedAutoSelectSubtitles() const { return resolvedProfile().autoSelectSubtitles == 1; }
+
+    bool hasFolderProfile() const { return m_folderProfiles.contains(m_currentFolder); }
+    Q_INVOKABLE void rememberFolderTracks(const QString &audioLanguage, const QString &subtitleLanguage, bool subtitlesOn);
+    Q_INVOKABLE void rememberFolderVolume(qreal volume);
+    Q_INVOKABLE void forgetFolderProfile();
+
+signals:
+    void preferredAudioLanguageChanged();
+    void preferredSubtitleLanguageChanged();
+    void autoSelectSubtitlesChanged();
+    void uiOpacityChanged();
+    void floatingUiChanged();
+    void shuffleChanged();
+    void repeatModeChanged();
+    void playlistSortOrderChanged();
+    void readAheadModeChanged();
+    void cropBlackBarsChanged();
+    void detectEpisodeMarkersChanged();
+    void skipCreditsChanged();
+    void frameCacheSizeChanged();
+    void folderProfileChanged();
+    void resolvedProfileChanged();
+
+private:
+    explicit UserSettings(QObject *parent = nullptr);
+    ~UserSettings();
+
+    void load();
+    void save();
+    void updateFolderProfile(const FolderProfile &profile);
+
+    template<typename T>
+    bool update(T &member, const T &value, const char *key);
+
+    static QString folderKey(const QString &filePath);
+    static void write(const QVariantHash &values);
+
+    static constexpr int SAVE_DELAY_MS = 500;
+
+    static UserSettings* s_instance;
+
+    QString m_preferredAudioLanguage;
+    QString m_preferredSubtitleLanguage;
+    bool m_autoSelectSubtitles;
+    qreal m_uiOpacity;
+    bool m_floatingUi;
+    bool m_shuffle;
+    int m_repeatMode;
+    int m_playlistSortOrder;
+    int m_readAheadMode;
+    bool m_cropBlackBars;
+    bool m_detectEpisodeMarkers;
+    bool m_skipCredits;
+    int m_frameCacheSize;
+
+    QHash<QString, FolderProfile> m_folderProfiles;
+    QString m_currentFolder;
+
+    // Keys changed since the last write, the pool has a single thread so writes land in order
+    QVariantHash m_pending;
+    QTimer m_saveTimer;
+    QThreadPool m_pool;
+};
+
+#endif // USERSETTINGS_H
@@ -0,0 +1,76 @@
+import QtQuick.Controls.FluentWinUI3
+import QtQuick.Controls.impl
+import QtQuick.Layouts
+import QtQuick
+import Odizinne.MediaPlayer
+
+Popup {
+    id: popup
+    visible: true
+    modal: false
+    opacity: 0.0
+    background.implicitWidth: 320
+    background.implicitHeight: 50
+    closePolicy: Popup.NoAutoClose
+    enter: null
+    exit: null
+
+    property MediaExporter exporter
+    property string message: ""
+
+    Behavior on opacity {
+        NumberAnimation {
+            duration: 200
+            easing.type: Easing.InOutQuad
+        }
+    }
+
+    Timer {
+        id: hideTimer
+        interval: 3000
+        onTriggered: popup.opacity = 0.0
+    }
+
+    Connections {
+        target: popup.exporter
+
+        function onBusyChanged() {
+            if (popup.exporter.busy) {
+                popup.message = qsTr("Exporting…")
+                hideTimer.stop()
+                popup.opacity = 1.0
+            }
+        }
+
+        function onExportFinished(filePath, error) {
+            popup.message = error !== "" ? error : qsTr("Saved %1").arg(MediaController.getFileName(filePath))
+            popup.opacity = 1.0
+            hideTimer.restart()
+        }
+    }
+
+    contentItem: RowLayout {
+        spacing: 10
+
+        Label {
+            text: popup.message
+            elide: Text.ElideMiddle
+            Layout.fillWidth: true
+        }
+
+        ProgressBar {
+            visible: popup.exporter && popup.exporter.busy
+            indeterminate: popup.exporter && popup.exporter.progress < 0
+            value: popup.exporter ? popup.exporter.progress : 0
+            Layout.preferredWidth: 90
+        }
+
+        NFToolButton {
+            visible: popup.exporter && popup.exporter.busy
+            icon.source: "qrc:/icons/close.svg"
+            icon.width: 12
+            icon.height: 12
+            onClicked: popup.exporter.cancel()
+        }
+    }
+}
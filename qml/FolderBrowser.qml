@@ -0,0 +1,96 @@
+import QtQuick.Controls.FluentWinUI3
+import QtQuick.Controls.impl
+import QtQuick.Layouts
+import QtQuick
+import Odizinne.MediaPlayer
+
+Dialog {
+    id: dialog
+    width: 860
+    height: 560
+    modal: true
+    title: "Browse Folder"
+    padding: 10
+
+    signal fileChosen(string url)
+
+    function choose(url) {
+        dialog.close()
+        dialog.fileChosen(url)
+    }
+
+    onOpened: {
+        grid.currentIndex = MediaController.currentIndex
+        grid.positionViewAtIndex(grid.currentIndex, GridView.Center)
+        grid.forceActiveFocus()
+    }
+
+    GridView {
+        id: grid
+        anchors.fill: parent
+        clip: true
+        cellWidth: 200
+        cellHeight: 150
+        // Only visible cells ask for thumbnails, scrolled away ones drop their pending request
+        cacheBuffer: 0
+        model: dialog.visible ? MediaController.playlist : []
+        highlightMoveDuration: 0
+        keyNavigationEnabled: true
+        Keys.onReturnPressed: if (currentIndex >= 0) dialog.choose(MediaController.playlist[currentIndex])
+
+        ScrollBar.vertical: ScrollBar {}
+
+        delegate: ItemDelegate {
+            id: cell
+            required property string modelData
+            required property int index
+            width: grid.cellWidth - 8
+            height: grid.cellHeight - 8
+            highlighted: index === MediaController.currentIndex || GridView.isCurrentItem
+            onClicked: dialog.choose(modelData)
+
+            contentItem: ColumnLayout {
+                spacing: 4
+
+                Item {
+                    Layout.fillWidth: true
+                    Layout.fillHeight: true
+
+                    Image {
+                        id: thumbnail
+                        anchors.fill: parent
+                        asynchronous: true
+                        fillMode: Image.PreserveAspectFit
+                        sourceSize.width: 320
+                        sourceSize.height: 180
+                        source: "image://thumbnails/" + encodeURIComponent(cell.modelData)
+                    }
+
+                    IconImage {
+                        anchors.centerIn: parent
+                        visible: thumbnail.status !== Image.Ready || thumbnail.implicitWidth === 0
+                        source: /\.(mp4|avi|mov|mkv|webm|wmv|m4v|flv)$/i.test(cell.modelData) ? "qrc:/icons/file.svg" : "qrc:/icons/music.svg"
+                        sourceSize.width: 32
+                        sourceSize.height: 32
+                        color: palette.windowText
+                        opacity: thumbnail.status === Image.Loading ? 0.3 : 0.6
+                    }
+                }
+
+                Label {
+                    text: MediaController.getFileName(cell.modelData)
+                    elide: Text.ElideMiddle
+                    horizontalAlignment: Text.AlignHCenter
+                    Layout.fillWidth: true
+                }
+            }
+        }
+
+        Label {
+            anchors.centerIn: parent
+            visible: grid.count === 0
+            text: "Nothing in the playlist"
+            opacity: 0.6
+        }
+    }
+}
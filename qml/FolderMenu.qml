@@ -0,0 +1,36 @@
+import QtQuick
+import QtQuick.Controls.FluentWinUI3
+import QtMultimedia
+import Odizinne.MediaPlayer
+
+// Per-folder profile actions, shared by the video and audio-only context menus
+Menu {
+    title: qsTr("This Folder")
+    enabled: Common.currentMediaPath !== ""
+
+    property MediaPlayer player
+
+    function trackLanguage(tracks, index) {
+        var track = index >= 0 ? tracks[index] : null
+        return track && track.stringValue ? (track.stringValue(6) || "") : ""
+    }
+
+    MenuItem {
+        text: qsTr("Remember Audio and Subtitle Tracks")
+        enabled: player !== null
+        onTriggered: {
+            UserSettings.rememberFolderTracks(trackLanguage(player.audioTracks, player.activeAudioTrack),
+                                              trackLanguage(player.subtitleTracks, player.activeSubtitleTrack),
+                                              player.activeSubtitleTrack !== -1)
+        }
+    }
+    MenuItem {
+        text: qsTr("Remember Volume")
+        onTriggered: UserSettings.rememberFolderVolume(Common.mediaVolume)
+    }
+    MenuItem {
+        text: qsTr("Forget Folder Settings")
+        enabled: UserSettings.hasFolderProfile
+        onTriggered: UserSettings.forgetFolderProfile()
+    }
+}
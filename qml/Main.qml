@@ -19,12 +19,13 @@ ApplicationWindow {
 
     property bool anyMenuOpen: audioTracksMenu.opened || subtitleTracksMenu.opened || settingsDialog.visible || contextMenu.opened || aboutDialog.visible
     property var currentAudioOutput: null
+    property real volumeOutsideFolder: -1
 
     PictureInPictureWindow {
         id: pipWindow
         isPlaying: mediaPlayer.playbackState === MediaPlayer.PlayingState
-        videoWidth: videoOutput ? videoOutput.videoSink.videoSize.width : 0
-        videoHeight: videoOutput ? videoOutput.videoSink.videoSize.height : 0
+        videoWidth: cropDetector.hasCrop ? cropDetector.croppedSize.width : (videoOutput ? videoOutput.videoSink.videoSize.width : 0)
+        videoHeight: cropDetector.hasCrop ? cropDetector.croppedSize.height : (videoOutput ? videoOutput.videoSink.videoSize.height : 0)
     }
 
     Connections {
@@ -64,11 +65,16 @@ ApplicationWindow {
 
     Connections {
         target: MediaController
-        function onTrackSelectionRequested(audioLanguage, subtitleLanguage, autoSelectSubtitles) {
-            if (mediaPlayer.audioTracks.length > 0 || mediaPlayer.subtitleTracks.length > 0) {
-                Qt.callLater(() => {
-                                 mediaPlayer.selectTracksWithPreferences(audioLanguage, subtitleLanguage, autoSelectSubtitles)
-                             })
+        function onFolderVolumeRequested(volume) {
+            // The volume set outside profiled folders comes back once playback leaves them
+            if (volume >= 0) {
+                if (window.volumeOutsideFolder < 0) {
+                    window.volumeOutsideFolder = Common.mediaVolume
+                }
+                Common.mediaVolume = volume
+            } else if (window.volumeOutsideFolder >= 0) {
+                Common.mediaVolume = window.volumeOutsideFolder
+                window.volumeOutsideFolder = -1
             }
         }
 
@@ -90,8 +96,7 @@ ApplicationWindow {
             Qt.callLater(() => {
                 // Convert local file path to file:// URL if needed
                 var sourceUrl = filePath.startsWith("file://") ? filePath : "file:///" + filePath.replace(/\\/g, "/")
-                Common.loadMedia(sourceUrl)
-                mediaPlayer.source = sourceUrl
+                MediaController.openSource(mediaPlayer, Common.loadMedia(sourceUrl))
             })
         }
     }
@@ -171,12 +176,18 @@ ApplicationWindow {
             mediaPlayer.stop()
             mediaPlayer.source = ""
             Qt.callLater(() => {
-                Common.loadMedia(nextFile)
-                mediaPlayer.source = nextFile
+                MediaController.openSource(mediaPlayer, Common.loadMedia(nextFile))
             })
         }
     }
 
+    function playlistTimeText() {
+        var remaining = MediaController.upcomingDuration + Math.max(0, mediaPlayer.duration - mediaPlayer.position)
+        var suffix = MediaController.playlistDurationComplete ? "" : "+"
+        return MediaController.formatDuration(MediaController.playlistDuration) + suffix + " total, " +
+               MediaController.formatDuration(remaining) + suffix + " left"
+    }
+
     function playPrevious() {
         if (mediaPlayer.position > 5000) {
             mediaPlayer.setPosition(0)
@@ -186,8 +197,7 @@ ApplicationWindow {
                 mediaPlayer.stop()
                 mediaPlayer.source = ""
                 Qt.callLater(() => {
-                    Common.loadMedia(previousFile)
-                    mediaPlayer.source = previousFile
+                    MediaController.openSource(mediaPlayer, Common.loadMedia(previousFile))
                 })
             } else {
                 mediaPlayer.setPosition(0)
@@ -299,6 +309,16 @@ ApplicationWindow {
         onActivated: fileDialog.open()
     }
 
+    Shortcut {
+        sequence: "Ctrl+P"
+        onActivated: quickOpenDialog.open()
+    }
+
+    Shortcut {
+        sequence: "Ctrl+B"
+        onActivated: folderBrowser.open()
+    }
+
     Shortcut {
         sequence: "Space"
         onActivated: {
@@ -349,20 +369,92 @@ ApplicationWindow {
         onActivated: window.playPrevious()
     }
 
+    Shortcut {
+        sequence: "."
+        enabled: Common.currentMediaPath !== "" && Common.isVideo
+        onActivated: frameStepper.stepForward()
+    }
+
+    Shortcut {
+        sequence: ","
+        enabled: Common.currentMediaPath !== "" && Common.isVideo
+        onActivated: frameStepper.stepBackward()
+    }
+
+    Shortcut {
+        sequence: "Ctrl+I"
+        enabled: Common.currentMediaPath !== "" && Common.isVideo
+        onActivated: statsOverlay.toggle()
+    }
+
     Component.onCompleted: {
         updateAudioDevice()
+        MediaController.setPlaybackStats(statsOverlay.stats)
         var initialPath = MediaController.getInitialMediaPath()
         if (initialPath !== "") {
-            Common.loadMedia(initialPath)
-            mediaPlayer.source = initialPath
+            MediaController.openSource(mediaPlayer, Common.loadMedia(initialPath))
         }
     }
 
+    Binding {
+        target: MediaController
+        property: "shuffle"
+        value: UserSettings.shuffle
+    }
+
+    Binding {
+        target: MediaController
+        property: "repeatMode"
+        value: UserSettings.repeatMode
+    }
+
+    Binding {
+        target: MediaController
+        property: "sortOrder"
+        value: UserSettings.playlistSortOrder
+    }
+
+    Binding {
+        target: MediaController
+        property: "readAheadMode"
+        value: UserSettings.readAheadMode
+    }
+
+    Binding {
+        target: MediaController
+        property: "detectEpisodeMarkers"
+        value: UserSettings.detectEpisodeMarkers
+    }
+
     MediaPlayer {
         id: mediaPlayer
+        loops: MediaController.repeatMode === MediaController.RepeatOne ? MediaPlayer.Infinite : 1
         audioOutput: playbackState === MediaPlayer.PlayingState ? (audioOutputLoader.item as AudioOutput) : null
         videoOutput: Common.isVideo ? videoOutput : null
 
+        property bool creditsSkipped: false
+
+        onSourceChanged: creditsSkipped = false
+
+        onPositionChanged: {
+            if (creditsSkipped || !UserSettings.detectEpisodeMarkers || !UserSettings.skipCredits || !Common.isVideo || MediaController.creditsStart < 0) {
+                return
+            }
+
+            if (position >= MediaController.creditsStart && position < MediaController.creditsEnd) {
+                creditsSkipped = true
+                // Credits that run to the end lead into the next episode, anything after them is kept
+                if (duration - MediaController.creditsEnd < 10000) {
+                    if (MediaController.hasNext && !sleepButton.checked) {
+                        statsOverlay.stats.markAutoAdvance()
+                        window.playNext()
+                    }
+                } else {
+                    mediaPlayer.setPosition(MediaController.creditsEnd)
+                }
+            }
+        }
+
         onPlaybackStateChanged: {
             MediaController.setPreventSleep(playbackState === MediaPlayer.PlayingState)
         }
@@ -371,7 +463,8 @@ ApplicationWindow {
             MediaController.updateTracks(audioTracks, subtitleTracks, activeAudioTrack, activeSubtitleTrack)
 
             if (audioTracks.length > 0 || subtitleTracks.length > 0) {
-                selectTracksWithPreferences(UserSettings.preferredAudioLanguage, UserSettings.preferredSubtitleLanguage, UserSettings.autoSelectSubtitles)
+                // Resolved against the folder being played, loading the file made it current before the tracks arrive
+                selectTracksWithPreferences(UserSettings.resolvedAudioLanguage, UserSettings.resolvedSubtitleLanguage, UserSettings.resolvedAutoSelectSubtitles)
             }
         }
 
@@ -379,8 +472,9 @@ ApplicationWindow {
             if (mediaStatus === MediaPlayer.LoadedMedia) {
                 if (Common.isVideo) {
                     if (mediaPlayer.hasVideo && videoOutput.sourceRect.width > 0) {
-                        Common.mediaWidth = videoOutput.sourceRect.width
-                        Common.mediaHeight = videoOutput.sourceRect.height
+                        // A crop remembered for this file is already published before the media loads
+                        Common.mediaWidth = cropDetector.hasCrop ? cropDetector.croppedSize.width : videoOutput.sourceRect.width
+                        Common.mediaHeight = cropDetector.hasCrop ? cropDetector.croppedSize.height : videoOutput.sourceRect.height
                         Qt.callLater(() => mediaPlayer.play())
                     } else {
                         Qt.callLater(() => {
@@ -401,6 +495,7 @@ ApplicationWindow {
                 if (sleepButton.checked && MediaController.hasNext) {
                     continuePlayingDialog.open()
                 } else if (MediaController.hasNext) {
+                    statsOverlay.stats.markAutoAdvance()
                     window.playNext()
                 }
             }
@@ -648,6 +743,30 @@ ApplicationWindow {
         anchors.centerIn: parent
     }
 
+    QuickOpenDialog {
+        id: quickOpenDialog
+        anchors.centerIn: parent
+        onFileChosen: function(url) {
+            mediaPlayer.stop()
+            mediaPlayer.source = ""
+            Qt.callLater(() => {
+                MediaController.openSource(mediaPlayer, Common.loadMedia(url))
+            })
+        }
+    }
+
+    FolderBrowser {
+        id: folderBrowser
+        anchors.centerIn: parent
+        onFileChosen: function(url) {
+            mediaPlayer.stop()
+            mediaPlayer.source = ""
+            Qt.callLater(() => {
+                MediaController.openSource(mediaPlayer, Common.loadMedia(url))
+            })
+        }
+    }
+
     ContinuePlayingDialog {
         id: continuePlayingDialog
         anchors.centerIn: parent
@@ -665,6 +784,28 @@ ApplicationWindow {
         value: Common.mediaVolume
     }
 
+    ExportIndicator {
+        z: 1001
+        id: exportIndicator
+        y: controlsToolbar.y - height - 80
+        x: (parent.width - width) / 2
+        exporter: mediaExporter
+    }
+
+    Button {
+        id: skipIntroButton
+        z: 1001
+        text: "Skip intro"
+        highlighted: true
+        visible: Common.isVideo && UserSettings.detectEpisodeMarkers && MediaController.introEnd > 0 &&
+                 mediaPlayer.position >= MediaController.introStart &&
+                 mediaPlayer.position < MediaController.introEnd - 1000
+        y: controlsToolbar.y - height - 20
+        anchors.right: parent.right
+        anchors.rightMargin: 20
+        onClicked: mediaPlayer.setPosition(MediaController.introEnd)
+    }
+
     ToolBar {
         id: fullscreenToolbar
         visible: window.visibility === Window.FullScreen && Common.currentMediaPath !== ""
@@ -978,6 +1119,46 @@ ApplicationWindow {
         }
     }
 
+    StatsOverlay {
+        id: statsOverlay
+        anchors.top: parent.top
+        anchors.left: parent.left
+        anchors.margins: 20
+        videoSink: videoOutput.videoSink
+        player: mediaPlayer
+    }
+
+    FrameStepper {
+        id: frameStepper
+        active: Common.isVideo
+        videoSink: videoOutput.videoSink
+        player: mediaPlayer
+        memoryLimit: UserSettings.frameCacheSize
+    }
+
+    MediaExporter {
+        id: mediaExporter
+        videoSink: videoOutput.videoSink
+        player: mediaPlayer
+    }
+
+    CropDetector {
+        id: cropDetector
+        active: UserSettings.cropBlackBars && Common.isVideo
+        videoSink: videoOutput.videoSink
+        player: mediaPlayer
+
+        onCropChanged: {
+            if (hasCrop) {
+                Common.mediaWidth = croppedSize.width
+                Common.mediaHeight = croppedSize.height
+            } else if (videoOutput.sourceRect.width > 0) {
+                Common.mediaWidth = videoOutput.sourceRect.width
+                Common.mediaHeight = videoOutput.sourceRect.height
+            }
+        }
+    }
+
     PlaybackOverlay {
         id: overlay
         anchors.centerIn: parent
@@ -1041,6 +1222,11 @@ ApplicationWindow {
                     enabled: Common.currentMediaPath !== ""
                     onTriggered: MediaController.openInExplorer(Common.currentMediaPath)
                 }
+                MenuItem {
+                    text: qsTr("Browse Folder")
+                    enabled: MediaController.playlistSize > 0
+                    onTriggered: folderBrowser.open()
+                }
                 MenuSeparator {}
 
                 Menu {
@@ -1119,18 +1305,78 @@ ApplicationWindow {
                     }
                 }
 
+                FolderMenu {
+                    player: mediaPlayer
+                }
+
                 MenuSeparator {}
                 MenuItem {
                     text: window.visibility === Window.FullScreen ? qsTr("Exit Fullscreen") : qsTr("Enter Fullscreen")
                     enabled: Common.currentMediaPath !== "" && Common.isVideo
                     onTriggered: window.toggleFullscreen()
                 }
+                MenuItem {
+                    text: qsTr("Crop Black Bars")
+                    checkable: true
+                    checked: UserSettings.cropBlackBars
+                    enabled: Common.currentMediaPath !== "" && Common.isVideo
+                    onTriggered: UserSettings.cropBlackBars = checked
+                }
+                MenuItem {
+                    text: qsTr("Playback Statistics")
+                    checkable: true
+                    checked: statsOverlay.visible
+                    enabled: Common.currentMediaPath !== "" && Common.isVideo
+                    onTriggered: statsOverlay.toggle()
+                }
+                MenuSeparator {}
+
+                Menu {
+                    title: qsTr("Save Snapshot")
+                    enabled: Common.currentMediaPath !== "" && Common.isVideo && !mediaExporter.busy
+
+                    MenuItem {
+                        text: "PNG"
+                        onTriggered: mediaExporter.saveSnapshot("png")
+                    }
+                    MenuItem {
+                        text: "JPEG"
+                        onTriggered: mediaExporter.saveSnapshot("jpg")
+                    }
+                }
+                MenuItem {
+                    text: mediaExporter.clipStart >= 0 ? qsTr("Set Clip Start (A: %1)").arg(MediaController.formatDuration(mediaExporter.clipStart))
+                                                       : qsTr("Set Clip Start (A)")
+                    enabled: Common.currentMediaPath !== "" && Common.isVideo
+                    onTriggered: mediaExporter.markClipStart()
+                }
+                MenuItem {
+                    text: mediaExporter.clipEnd >= 0 ? qsTr("Set Clip End (B: %1)").arg(MediaController.formatDuration(mediaExporter.clipEnd))
+                                                     : qsTr("Set Clip End (B)")
+                    enabled: Common.currentMediaPath !== "" && Common.isVideo
+                    onTriggered: mediaExporter.markClipEnd()
+                }
+                MenuItem {
+                    text: qsTr("Export Clip")
+                    enabled: mediaExporter.canExportClip && !mediaExporter.busy
+                    onTriggered: mediaExporter.exportClip()
+                }
             }
             id: videoOutput
-            anchors.fill: parent
             visible: Common.isVideo && Common.currentMediaPath !== ""
             fillMode: VideoOutput.PreserveAspectFit
 
+            // Sized so the detected active area is what fits the parent, the bars spill outside
+            readonly property rect cropRect: cropDetector.cropRect
+            readonly property real croppedAspect: cropDetector.hasCrop && cropDetector.croppedSize.height > 0 ?
+                                                      cropDetector.croppedSize.width / cropDetector.croppedSize.height : 0
+            readonly property real visibleWidth: croppedAspect > 0 ? Math.min(parent.width, parent.height * croppedAspect) : parent.width
+            readonly property real visibleHeight: croppedAspect > 0 ? Math.min(parent.height, parent.width / croppedAspect) : parent.height
+            x: (parent.width - visibleWidth) / 2 - cropRect.x * width
+            y: (parent.height - visibleHeight) / 2 - cropRect.y * height
+            width: visibleWidth / cropRect.width
+            height: visibleHeight / cropRect.height
+
             property bool waitingForDoubleClick: false
 
             Timer {
@@ -1163,10 +1409,46 @@ ApplicationWindow {
         }
 
         Rectangle {
+            id: audioOnlyView
             anchors.fill: parent
             color: window.color
             visible: !Common.isVideo && Common.currentMediaPath !== ""
 
+            ContextMenu.menu: Menu {
+                enabled: !Common.isPIP
+
+                MenuItem {
+                    text: qsTr("Copy File Path")
+                    onTriggered: MediaController.copyFilePathToClipboard(Common.currentMediaPath)
+                }
+                MenuItem {
+                    text: qsTr("Open in Explorer")
+                    onTriggered: MediaController.openInExplorer(Common.currentMediaPath)
+                }
+                MenuItem {
+                    text: qsTr("Browse Folder")
+                    enabled: MediaController.playlistSize > 0
+                    onTriggered: folderBrowser.open()
+                }
+                MenuSeparator {}
+
+                FolderMenu {
+                    player: mediaPlayer
+                }
+            }
+
+            SpectrumVisualizer {
+                anchors.left: parent.left
+                anchors.right: parent.right
+                anchors.bottom: parent.bottom
+                anchors.margins: 15
+                height: parent.height * 0.35
+                player: mediaPlayer
+                active: audioOnlyView.visible && mediaPlayer.playbackState === MediaPlayer.PlayingState
+                color: palette.accent
+                opacity: 0.6
+            }
+
             Column {
                 anchors.left: parent.left
                 anchors.top: parent.top
@@ -1243,6 +1525,13 @@ ApplicationWindow {
                     font.pointSize: 12
                 }
 
+                Label {
+                    text: window.playlistTimeText()
+                    visible: MediaController.playlistSize > 1 && MediaController.playlistDuration > 0
+                    opacity: 0.5
+                    font.pointSize: 12
+                }
+
                 Column {
                     spacing: 5
                     visible: mediaPlayer.audioTracks.length > 1 || mediaPlayer.subtitleTracks.length > 0
@@ -1282,7 +1571,7 @@ ApplicationWindow {
             onEntered: function(drag) {
                 if (drag.hasUrls) {
                     var supportedFormats = [".mp4", ".avi", ".mov", ".mkv", ".webm", ".wmv", ".m4v", ".flv",
-                                            ".mp3", ".wav", ".flac", ".ogg", ".aac", ".wma", ".m4a"]
+                                            ".mp3", ".wav", ".flac", ".ogg", ".aac", ".wma", ".m4a", ".zip", ".tar"]
                     var hasMediaFile = false
 
                     for (var i = 0; i < drag.urls.length; i++) {
@@ -1307,14 +1596,13 @@ ApplicationWindow {
             onDropped: function(drop) {
                 if (drop.hasUrls && drop.urls.length > 0) {
                     var supportedFormats = [".mp4", ".avi", ".mov", ".mkv", ".webm", ".wmv", ".m4v", ".flv",
-                                            ".mp3", ".wav", ".flac", ".ogg", ".aac", ".wma", ".m4a"]
+                                            ".mp3", ".wav", ".flac", ".ogg", ".aac", ".wma", ".m4a", ".zip", ".tar"]
 
                     for (var i = 0; i < drop.urls.length; i++) {
                         var url = drop.urls[i].toString().toLowerCase()
                         for (var j = 0; j < supportedFormats.length; j++) {
                             if (url.includes(supportedFormats[j])) {
-                                Common.loadMedia(drop.urls[i])
-                                mediaPlayer.source = drop.urls[i]
+                                MediaController.openSource(mediaPlayer, Common.loadMedia(drop.urls[i]))
                                 drop.accept(Qt.CopyAction)
                                 return
                             }
@@ -1471,6 +1759,15 @@ ApplicationWindow {
                 Layout.alignment: Qt.AlignCenter
                 Layout.preferredWidth: timelineFontMetrics.width
                 horizontalAlignment: Text.AlignLeft
+
+                HoverHandler {
+                    id: totalTimeHover
+                }
+
+                ToolTip {
+                    visible: totalTimeHover.hovered && MediaController.playlistSize > 1 && MediaController.playlistDuration > 0
+                    text: "Playlist: " + window.playlistTimeText()
+                }
             }
         }
 
@@ -1488,6 +1785,52 @@ ApplicationWindow {
             ToolTip.text: checked ? "Sleep mode: ON (will ask before playing next)" : "Sleep mode: OFF"
         }
 
+        Row {
+            anchors.left: sleepButton.right
+            anchors.leftMargin: 6
+            anchors.verticalCenter: parent.verticalCenter
+            anchors.verticalCenterOffset: 20
+            spacing: 6
+
+            NFToolButton {
+                icon.source: "qrc:/icons/shuffle.svg"
+                width: 48
+                height: 48
+                checkable: true
+                checked: UserSettings.shuffle
+                onClicked: UserSettings.shuffle = checked
+                ToolTip.visible: hovered
+                ToolTip.text: checked ? "Shuffle: ON" : "Shuffle: OFF"
+            }
+
+            NFToolButton {
+                icon.source: UserSettings.repeatMode === MediaController.RepeatOne ? "qrc:/icons/repeat_one.svg" : "qrc:/icons/repeat.svg"
+                width: 48
+                height: 48
+                checkable: true
+                checked: UserSettings.repeatMode !== MediaController.RepeatOff
+                onClicked: {
+                    if (UserSettings.repeatMode === MediaController.RepeatOff) {
+                        UserSettings.repeatMode = MediaController.RepeatAll
+                    } else if (UserSettings.repeatMode === MediaController.RepeatAll) {
+                        UserSettings.repeatMode = MediaController.RepeatOne
+                    } else {
+                        UserSettings.repeatMode = MediaController.RepeatOff
+                    }
+                    checked = Qt.binding(() => UserSettings.repeatMode !== MediaController.RepeatOff)
+                }
+                ToolTip.visible: hovered
+                ToolTip.text: {
+                    if (UserSettings.repeatMode === MediaController.RepeatAll) {
+                        return "Repeat: All"
+                    } else if (UserSettings.repeatMode === MediaController.RepeatOne) {
+                        return "Repeat: One"
+                    }
+                    return "Repeat: OFF"
+                }
+            }
+        }
+
         Row {
             anchors.horizontalCenter: parent.horizontalCenter
             anchors.verticalCenter: parent.verticalCenter
@@ -1634,15 +1977,15 @@ ApplicationWindow {
         title: "Open Media File"
         fileMode: FileDialog.OpenFile
         nameFilters: [
-            "Media files (*.mp4 *.avi *.mov *.mkv *.webm *.wmv *.m4v *.flv *.mp3 *.wav *.flac *.ogg *.aac *.wma *.m4a)",
+            "Media files (*.mp4 *.avi *.mov *.mkv *.webm *.wmv *.m4v *.flv *.mp3 *.wav *.flac *.ogg *.aac *.wma *.m4a *.zip *.tar)",
             "Video files (*.mp4 *.avi *.mov *.mkv *.webm *.wmv *.m4v *.flv)",
             "Audio files (*.mp3 *.wav *.flac *.ogg *.aac *.wma *.m4a)",
+            "Uncompressed archives (*.zip *.tar)",
             "All files (*)"
         ]
 
         onAccepted: {
-            Common.loadMedia(selectedFile)
-            mediaPlayer.source = selectedFile
+            MediaController.openSource(mediaPlayer, Common.loadMedia(selectedFile))
         }
     }
 }
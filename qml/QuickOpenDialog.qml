@@ -0,0 +1,94 @@
+import QtQuick.Controls.FluentWinUI3
+import QtQuick.Layouts
+import QtQuick
+import Odizinne.MediaPlayer
+
+Dialog {
+    id: dialog
+    width: 560
+    height: 420
+    modal: true
+    title: "Quick Open"
+    padding: 10
+
+    signal fileChosen(string url)
+
+    property var results: []
+
+    function search() {
+        results = MediaController.searchFiles(searchField.text)
+        resultList.currentIndex = results.length > 0 ? 0 : -1
+    }
+
+    function choose(index) {
+        if (index < 0 || index >= results.length) {
+            return
+        }
+        var url = results[index].url
+        dialog.close()
+        dialog.fileChosen(url)
+    }
+
+    onOpened: {
+        searchField.text = ""
+        search()
+        searchField.forceActiveFocus()
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        spacing: 10
+
+        TextField {
+            id: searchField
+            placeholderText: "Search played files and folders"
+            Layout.fillWidth: true
+            onTextChanged: dialog.search()
+            onAccepted: dialog.choose(resultList.currentIndex)
+            Keys.onDownPressed: resultList.incrementCurrentIndex()
+            Keys.onUpPressed: resultList.decrementCurrentIndex()
+        }
+
+        ListView {
+            id: resultList
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            clip: true
+            model: dialog.results
+            highlightMoveDuration: 0
+
+            delegate: ItemDelegate {
+                required property var modelData
+                required property int index
+                width: resultList.width
+                highlighted: ListView.isCurrentItem
+                onClicked: dialog.choose(index)
+
+                contentItem: Column {
+                    spacing: 2
+
+                    Label {
+                        text: modelData.name
+                        elide: Text.ElideRight
+                        width: parent.width
+                    }
+
+                    Label {
+                        text: modelData.location
+                        opacity: 0.6
+                        font.pointSize: 9
+                        elide: Text.ElideMiddle
+                        width: parent.width
+                    }
+                }
+            }
+
+            Label {
+                anchors.centerIn: parent
+                visible: dialog.results.length === 0
+                text: searchField.text === "" ? "Nothing played yet" : "No matches"
+                opacity: 0.6
+            }
+        }
+    }
+}
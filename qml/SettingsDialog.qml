@@ -91,6 +91,140 @@ Dialog {
             }
         }
 
+        RowLayout {
+            Label {
+                text: "Playlist order"
+                Layout.fillWidth: true
+            }
+
+            ComboBox {
+                id: playlistOrderCombo
+                model: ListModel {
+                    ListElement { text: "Name"; value: 0 }
+                    ListElement { text: "Date modified"; value: 1 }
+                    ListElement { text: "Size"; value: 2 }
+                    ListElement { text: "Track number"; value: 3 }
+                }
+
+                textRole: "text"
+
+                Component.onCompleted: {
+                    for (let i = 0; i < model.count; i++) {
+                        if (model.get(i).value === UserSettings.playlistSortOrder) {
+                            currentIndex = i
+                            break
+                        }
+                    }
+                }
+
+                onActivated: function(index) {
+                    UserSettings.playlistSortOrder = model.get(index).value
+                }
+            }
+        }
+
+        RowLayout {
+            Label {
+                text: "Read-ahead buffering"
+                Layout.fillWidth: true
+            }
+
+            ComboBox {
+                id: readAheadCombo
+                model: ListModel {
+                    ListElement { text: "Network drives"; value: 0 }
+                    ListElement { text: "Always"; value: 1 }
+                    ListElement { text: "Off"; value: 2 }
+                }
+
+                textRole: "text"
+
+                Component.onCompleted: {
+                    for (let i = 0; i < model.count; i++) {
+                        if (model.get(i).value === UserSettings.readAheadMode) {
+                            currentIndex = i
+                            break
+                        }
+                    }
+                }
+
+                onActivated: function(index) {
+                    UserSettings.readAheadMode = model.get(index).value
+                }
+            }
+        }
+
+        RowLayout {
+            Label {
+                text: "Frame step memory"
+                Layout.fillWidth: true
+            }
+
+            ComboBox {
+                id: frameCacheCombo
+                model: ListModel {
+                    ListElement { text: "Off"; value: 0 }
+                    ListElement { text: "128 MB"; value: 128 }
+                    ListElement { text: "256 MB"; value: 256 }
+                    ListElement { text: "512 MB"; value: 512 }
+                    ListElement { text: "1 GB"; value: 1024 }
+                }
+
+                textRole: "text"
+
+                Component.onCompleted: {
+                    for (let i = 0; i < model.count; i++) {
+                        if (model.get(i).value === UserSettings.frameCacheSize) {
+                            currentIndex = i
+                            break
+                        }
+                    }
+                }
+
+                onActivated: function(index) {
+                    UserSettings.frameCacheSize = model.get(index).value
+                }
+            }
+        }
+
+        RowLayout {
+            Label {
+                text: "Crop black bars"
+                Layout.fillWidth: true
+            }
+
+            Switch {
+                checked: UserSettings.cropBlackBars
+                onClicked: UserSettings.cropBlackBars = checked
+            }
+        }
+
+        RowLayout {
+            Label {
+                text: "Detect intros and credits"
+                Layout.fillWidth: true
+            }
+
+            Switch {
+                checked: UserSettings.detectEpisodeMarkers
+                onClicked: UserSettings.detectEpisodeMarkers = checked
+            }
+        }
+
+        RowLayout {
+            enabled: UserSettings.detectEpisodeMarkers
+
+            Label {
+                text: "Skip end credits"
+                Layout.fillWidth: true
+            }
+
+            Switch {
+                checked: UserSettings.skipCredits
+                onClicked: UserSettings.skipCredits = checked
+            }
+        }
+
         RowLayout {
             Label {
                 text: "Floating Ui"
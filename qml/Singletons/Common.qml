@@ -34,7 +34,8 @@ Item {
         }
     }
 
-    function loadMedia(mediaPath) {
+    function loadMedia(source) {
+        var mediaPath = MediaController.resolveSource(source.toString())
         currentMediaPath = mediaPath
         mediaFileSize = MediaController.getFileSize(mediaPath)
 
@@ -47,6 +48,8 @@ Item {
                 path.includes('.mov') || path.includes('.mkv') ||
                 path.includes('.webm') || path.includes('.wmv') ||
                 path.includes('.m4v') || path.includes('.flv')
+
+        return mediaPath
     }
 
     function getFileName(filePath) {
@@ -0,0 +1,122 @@
+import QtQuick
+import QtQuick.Controls.FluentWinUI3
+import QtMultimedia
+import Odizinne.MediaPlayer
+
+Rectangle {
+    id: statsOverlay
+    width: 260
+    height: statsColumn.implicitHeight + 20
+    color: Qt.rgba(0, 0, 0, 0.8)
+    radius: 5
+    z: 1001
+    visible: false
+
+    property alias videoSink: stats.videoSink
+    property alias player: stats.player
+    readonly property alias stats: stats
+
+    function toggle() {
+        visible = !visible
+    }
+
+    PlaybackStats {
+        id: stats
+        active: statsOverlay.visible
+    }
+
+    Column {
+        id: statsColumn
+        anchors.left: parent.left
+        anchors.right: parent.right
+        anchors.top: parent.top
+        anchors.margins: 10
+        spacing: 4
+
+        Label {
+            text: "Playback statistics"
+            color: "white"
+            font.bold: true
+        }
+
+        Label {
+            text: "Frame rate: " + stats.effectiveFps.toFixed(1) + " / " + stats.nominalFps.toFixed(2) + " fps"
+            color: "white"
+        }
+
+        Label {
+            text: "Arrival jitter: " + stats.jitterMs.toFixed(2) + " ms"
+            color: "white"
+        }
+
+        Label {
+            text: "Frames: " + stats.totalFrames + "  dropped: " + stats.droppedFrames + "  late: " + stats.lateFrames
+            color: "white"
+        }
+
+        Label {
+            text: "Mean presentation delay: " + stats.meanDelayMs.toFixed(2) + " ms"
+            color: "white"
+        }
+
+        Label {
+            text: "Bitrate: " + (stats.bitrate / 1000000).toFixed(2) + " Mbit/s"
+            color: "white"
+        }
+
+        Label {
+            text: "I/O throughput: " + (stats.ioThroughput > 0 ? Common.formatFileSize(stats.ioThroughput) + "/s" : "n/a")
+            color: "white"
+        }
+
+        Label {
+            text: "I/O stalls: " + stats.ioStalls + " (" + stats.ioStallMs.toFixed(0) + " ms)"
+            color: "white"
+        }
+
+        Label {
+            text: "Open: " + (stats.openLatencyMs >= 0 ? stats.openLatencyMs.toFixed(0) + " ms" : "n/a") +
+                  "  advance: " + (stats.advanceLatencyMs >= 0 ? stats.advanceLatencyMs.toFixed(0) + " ms" : "n/a")
+            color: "white"
+        }
+
+        Label {
+            text: "Presentation delay (ms)"
+            color: "white"
+            opacity: 0.7
+            topPadding: 4
+        }
+
+        Row {
+            id: histogramRow
+            spacing: 4
+            height: 50
+
+            readonly property real maxCount: Math.max(1, Math.max.apply(Math, stats.delayHistogram))
+
+            Repeater {
+                model: stats.delayHistogram.length
+
+                Column {
+                    required property int index
+                    anchors.bottom: parent.bottom
+                    spacing: 2
+
+                    Rectangle {
+                        anchors.horizontalCenter: parent.horizontalCenter
+                        width: 24
+                        height: Math.max(1, 34 * stats.delayHistogram[parent.index] / histogramRow.maxCount)
+                        color: palette.accent
+                    }
+
+                    Label {
+                        anchors.horizontalCenter: parent.horizontalCenter
+                        text: stats.delayHistogramLabels[parent.index]
+                        color: "white"
+                        font.pointSize: 7
+                    }
+                }
+            }
+        }
+    }
+}
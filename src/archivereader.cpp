@@ -0,0 +1,375 @@
+#include "archivereader.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimeZone>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+struct CachedIndex
+{
+    qint64 size = -1;
+    qint64 modified = -1;
+    QList<ArchiveMember> members;
+};
+
+QMutex s_cacheMutex;
+QHash<QString, CachedIndex> s_cache;
+
+const quint32 ZIP_LOCAL_HEADER = 0x04034b50;
+const quint32 ZIP_CENTRAL_HEADER = 0x02014b50;
+const quint32 ZIP_END_OF_CENTRAL_DIRECTORY = 0x06054b50;
+const quint32 ZIP64_END_LOCATOR = 0x07064b50;
+const quint32 ZIP64_END_OF_CENTRAL_DIRECTORY = 0x06064b50;
+const int TAR_BLOCK = 512;
+
+QByteArray readAt(QFile &file, qint64 offset, qint64 length)
+{
+    if (offset < 0 || !file.seek(offset)) {
+        return QByteArray();
+    }
+    return file.read(length);
+}
+
+template <typename T>
+T le(const QByteArray &data, qsizetype offset)
+{
+    return qFromLittleEndian<T>(data.constData() + offset);
+}
+
+qint64 tarNumber(const char *field, int length)
+{
+    // Large sizes use the base-256 extension, flagged by the high bit
+    if (uchar(field[0]) & 0x80) {
+        qint64 value = uchar(field[0]) & 0x7f;
+        for (int i = 1; i < length; ++i) {
+            value = (value << 8) | uchar(field[i]);
+        }
+        return value;
+    }
+
+    qint64 value = 0;
+    for (int i = 0; i < length; ++i) {
+        if (field[i] >= '0' && field[i] <= '7') {
+            value = value * 8 + (field[i] - '0');
+        } else if (field[i] != ' ' || value != 0) {
+            break;
+        }
+    }
+    return value;
+}
+
+QString tarString(const char *field, int length)
+{
+    return QString::fromUtf8(field, qstrnlen(field, length));
+}
+
+QString paxPath(const QByteArray &records)
+{
+    qsizetype pos = 0;
+    while (pos < records.size()) {
+        const qsizetype space = records.indexOf(' ', pos);
+        if (space < 0) {
+            break;
+        }
+        const qsizetype length = records.mid(pos, space - pos).toLongLong();
+        if (length <= 0) {
+            break;
+        }
+        const QByteArray record = records.mid(space + 1, length - (space - pos) - 2);
+        if (record.startsWith("path=")) {
+            return QString::fromUtf8(record.mid(5));
+        }
+        pos += length;
+    }
+    return QString();
+}
+
+}
+
+bool ArchiveIndex::isArchive(const QString &filePath)
+{
+    const QString lower = filePath.toLower();
+    return lower.endsWith(".zip") || lower.endsWith(".tar");
+}
+
+QList<ArchiveMember> ArchiveIndex::members(const QString &archivePath)
+{
+    const QFileInfo info(archivePath);
+    const QString key = info.absoluteFilePath();
+    const qint64 modified = info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+
+    {
+        QMutexLocker locker(&s_cacheMutex);
+        auto cached = s_cache.constFind(key);
+        if (cached != s_cache.cend() && cached->size == info.size() && cached->modified == modified) {
+            return cached->members;
+        }
+    }
+
+    QFile file(key);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open archive:" << archivePath;
+        return {};
+    }
+
+    CachedIndex index;
+    index.size = info.size();
+    index.modified = modified;
+    index.members = key.toLower().endsWith(".zip") ? readZip(file) : readTar(file);
+
+    QMutexLocker locker(&s_cacheMutex);
+    s_cache.insert(key, index);
+    return index.members;
+}
+
+bool ArchiveIndex::findMember(const QString &archivePath, const QString &memberName, ArchiveMember &member)
+{
+    const QList<ArchiveMember> archiveMembers = members(archivePath);
+    for (const ArchiveMember &candidate : archiveMembers) {
+        if (candidate.name == memberName) {
+            member = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QUrl ArchiveIndex::memberUrl(const QString &archivePath, const QString &memberName)
+{
+    QUrl url = QUrl::fromLocalFile(archivePath);
+    url.setFragment(memberName);
+    return url;
+}
+
+bool ArchiveIndex::splitMemberUrl(const QUrl &url, QString &archivePath, QString &memberName)
+{
+    if (!url.isLocalFile() || !url.hasFragment() || !isArchive(url.toLocalFile())) {
+        return false;
+    }
+
+    archivePath = url.toLocalFile();
+    memberName = url.fragment(QUrl::FullyDecoded);
+    return !memberName.isEmpty();
+}
+
+QList<ArchiveMember> ArchiveIndex::readZip(QFile &file)
+{
+    QList<ArchiveMember> result;
+
+    // The end of central directory record sits within the last 64 KiB (its comment)
+    const qint64 tailSize = qMin<qint64>(file.size(), 0xffff + 22);
+    const QByteArray tail = readAt(file, file.size() - tailSize, tailSize);
+    qsizetype eocd = -1;
+    for (qsizetype i = tail.size() - 22; i >= 0; --i) {
+        if (le<quint32>(tail, i) == ZIP_END_OF_CENTRAL_DIRECTORY) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0) {
+        qWarning() << "Not a ZIP archive:" << file.fileName();
+        return result;
+    }
+
+    quint64 entryCount = le<quint16>(tail, eocd + 10);
+    quint64 directorySize = le<quint32>(tail, eocd + 12);
+    quint64 directoryOffset = le<quint32>(tail, eocd + 16);
+
+    if ((entryCount == 0xffff || directorySize == 0xffffffff || directoryOffset == 0xffffffff) && eocd >= 20 &&
+        le<quint32>(tail, eocd - 20) == ZIP64_END_LOCATOR) {
+        const QByteArray zip64 = readAt(file, le<quint64>(tail, eocd - 20 + 8), 56);
+        if (zip64.size() == 56 && le<quint32>(zip64, 0) == ZIP64_END_OF_CENTRAL_DIRECTORY) {
+            entryCount = le<quint64>(zip64, 32);
+            directorySize = le<quint64>(zip64, 40);
+            directoryOffset = le<quint64>(zip64, 48);
+        }
+    }
+
+    const QByteArray directory = readAt(file, qint64(directoryOffset), qint64(directorySize));
+    qsizetype pos = 0;
+
+    for (quint64 i = 0; i < entryCount && pos + 46 <= directory.size(); ++i) {
+        if (le<quint32>(directory, pos) != ZIP_CENTRAL_HEADER) {
+            break;
+        }
+
+        const quint16 flags = le<quint16>(directory, pos + 8);
+        const quint16 method = le<quint16>(directory, pos + 10);
+        quint64 compressedSize = le<quint32>(directory, pos + 20);
+        quint64 uncompressedSize = le<quint32>(directory, pos + 24);
+        const quint16 nameLength = le<quint16>(directory, pos + 28);
+        const quint16 extraLength = le<quint16>(directory, pos + 30);
+        const quint16 commentLength = le<quint16>(directory, pos + 32);
+        quint64 localOffset = le<quint32>(directory, pos + 42);
+
+        const qsizetype next = pos + 46 + nameLength + extraLength + commentLength;
+        if (next > directory.size()) {
+            break;
+        }
+
+        const QByteArray rawName = directory.mid(pos + 46, nameLength);
+        const QString name = (flags & 0x0800) ? QString::fromUtf8(rawName) : QString::fromLatin1(rawName);
+
+        // ZIP64 extra field carries whichever 32-bit fields overflowed, in this order
+        qsizetype extra = pos + 46 + nameLength;
+        const qsizetype extraEnd = extra + extraLength;
+        while (extra + 4 <= extraEnd) {
+            const quint16 id = le<quint16>(directory, extra);
+            const quint16 size = le<quint16>(directory, extra + 2);
+            qsizetype field = extra + 4;
+            if (id == 0x0001) {
+                if (uncompressedSize == 0xffffffff && field + 8 <= extraEnd) {
+                    uncompressedSize = le<quint64>(directory, field);
+                    field += 8;
+                }
+                if (compressedSize == 0xffffffff && field + 8 <= extraEnd) {
+                    compressedSize = le<quint64>(directory, field);
+                    field += 8;
+                }
+                if (localOffset == 0xffffffff && field + 8 <= extraEnd) {
+                    localOffset = le<quint64>(directory, field);
+                }
+                break;
+            }
+            extra += 4 + size;
+        }
+
+        pos = next;
+
+        // Only stored, unencrypted files can be exposed as a plain byte range
+        if (method != 0 || (flags & 0x0001) || compressedSize != uncompressedSize || name.endsWith('/')) {
+            continue;
+        }
+
+        const QByteArray local = readAt(file, qint64(localOffset), 30);
+        if (local.size() < 30 || le<quint32>(local, 0) != ZIP_LOCAL_HEADER) {
+            continue;
+        }
+
+        ArchiveMember member;
+        member.name = name;
+        member.offset = qint64(localOffset) + 30 + le<quint16>(local, 26) + le<quint16>(local, 28);
+        member.size = qint64(uncompressedSize);
+        if (member.offset + member.size <= file.size()) {
+            result.append(member);
+        }
+    }
+
+    return result;
+}
+
+QList<ArchiveMember> ArchiveIndex::readTar(QFile &file)
+{
+    QList<ArchiveMember> result;
+    QString longName;
+    qint64 pos = 0;
+
+    while (pos + TAR_BLOCK <= file.size()) {
+        const QByteArray header = readAt(file, pos, TAR_BLOCK);
+        if (header.size() < TAR_BLOCK || header.count('\0') == TAR_BLOCK) {
+            break;
+        }
+
+        const char *h = header.constData();
+        const qint64 size = tarNumber(h + 124, 12);
+        const char type = h[156];
+        const qint64 dataOffset = pos + TAR_BLOCK;
+        pos = dataOffset + (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+
+        if (type == 'L') {
+            longName = QString::fromUtf8(readAt(file, dataOffset, size)).section(QChar(0), 0, 0);
+            continue;
+        }
+        if (type == 'x') {
+            longName = paxPath(readAt(file, dataOffset, size));
+            continue;
+        }
+        if (type != '0' && type != '\0') {
+            longName.clear();
+            continue;
+        }
+
+        ArchiveMember member;
+        member.name = longName;
+        if (member.name.isEmpty()) {
+            member.name = tarString(h, 100);
+            if (std::memcmp(h + 257, "ustar", 5) == 0 && h[345] != '\0') {
+                member.name = tarString(h + 345, 155) + '/' + member.name;
+            }
+        }
+        member.offset = dataOffset;
+        member.size = size;
+        longName.clear();
+
+        if (dataOffset + size <= file.size()) {
+            result.append(member);
+        }
+    }
+
+    return result;
+}
+
+ArchiveMemberDevice::ArchiveMemberDevice(const QString &archivePath, const ArchiveMember &member, QObject *parent)
+    : QIODevice(parent), m_file(archivePath), m_member(member), m_data(nullptr)
+{
+}
+
+ArchiveMemberDevice::~ArchiveMemberDevice()
+{
+    close();
+}
+
+bool ArchiveMemberDevice::open(OpenMode mode)
+{
+    if ((mode & QIODevice::WriteOnly) || !m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    if (m_member.size > 0) {
+        m_data = m_file.map(m_member.offset, m_member.size);
+        if (!m_data) {
+            qWarning() << "Could not map archive member:" << m_member.name << m_file.errorString();
+            m_file.close();
+            return false;
+        }
+    }
+
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void ArchiveMemberDevice::close()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+        m_data = nullptr;
+    }
+    m_file.close();
+
+    if (isOpen()) {
+        QIODevice::close();
+    }
+}
+
+qint64 ArchiveMemberDevice::readData(char *data, qint64 maxSize)
+{
+    const qint64 length = qMin(maxSize, m_member.size - pos());
+    if (length <= 0) {
+        return 0;
+    }
+
+    std::memcpy(data, m_data + pos(), length);
+    return length;
+}
+
+qint64 ArchiveMemberDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
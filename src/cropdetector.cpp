@@ -0,0 +1,410 @@
+#include "cropdetector.h"
+#include <QMutexLocker>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CROPDETECTOR_SSE 1
+#endif
+
+QHash<QString, CropDetector::CacheEntry> CropDetector::s_cache;
+
+namespace {
+
+// Mean luma a row or column needs to count as picture, on an 8-bit scale
+const quint32 ACTIVE_LUMA = 28;
+
+struct LumaPlane
+{
+    const uchar *data = nullptr;
+    int stride = 0;
+    int step = 1;
+    bool tenBit = false;
+    int width = 0;
+    int height = 0;
+};
+
+bool lumaPlane(const QVideoFrame &frame, LumaPlane &plane)
+{
+    plane.data = frame.bits(0);
+    plane.stride = frame.bytesPerLine(0);
+    plane.width = frame.width();
+    plane.height = frame.height();
+
+    switch (frame.pixelFormat()) {
+    case QVideoFrameFormat::Format_YUV420P:
+    case QVideoFrameFormat::Format_YUV422P:
+    case QVideoFrameFormat::Format_YV12:
+    case QVideoFrameFormat::Format_NV12:
+    case QVideoFrameFormat::Format_NV21:
+    case QVideoFrameFormat::Format_IMC1:
+    case QVideoFrameFormat::Format_IMC2:
+    case QVideoFrameFormat::Format_IMC3:
+    case QVideoFrameFormat::Format_IMC4:
+    case QVideoFrameFormat::Format_Y8:
+        plane.step = 1;
+        break;
+    case QVideoFrameFormat::Format_P010:
+    case QVideoFrameFormat::Format_P016:
+    case QVideoFrameFormat::Format_Y16:
+        // Little endian 16-bit samples filled from the top, the high byte is enough here
+        plane.data += 1;
+        plane.step = 2;
+        break;
+    case QVideoFrameFormat::Format_YUV420P10:
+        // 10-bit samples in the low bits of each 16-bit word, the high byte is nearly always 0
+        plane.step = 2;
+        plane.tenBit = true;
+        break;
+    case QVideoFrameFormat::Format_YUYV:
+        plane.step = 2;
+        break;
+    case QVideoFrameFormat::Format_UYVY:
+        plane.data += 1;
+        plane.step = 2;
+        break;
+    case QVideoFrameFormat::Format_ARGB8888:
+    case QVideoFrameFormat::Format_ARGB8888_Premultiplied:
+    case QVideoFrameFormat::Format_XRGB8888:
+    case QVideoFrameFormat::Format_ABGR8888:
+    case QVideoFrameFormat::Format_XBGR8888:
+        // Green follows luma closely enough to find black bars
+        plane.data += 2;
+        plane.step = 4;
+        break;
+    case QVideoFrameFormat::Format_BGRA8888:
+    case QVideoFrameFormat::Format_BGRA8888_Premultiplied:
+    case QVideoFrameFormat::Format_BGRX8888:
+    case QVideoFrameFormat::Format_RGBA8888:
+    case QVideoFrameFormat::Format_RGBX8888:
+        plane.data += 1;
+        plane.step = 4;
+        break;
+    default:
+        return false;
+    }
+
+    return plane.data && plane.width > 0 && plane.height > 0;
+}
+
+/**
+ * Adds a row of 8-bit samples to the column sums and returns the row sum
+ */
+quint32 accumulateRow(const uchar *row, int width, quint32 *columns)
+{
+    int x = 0;
+    quint32 sum = 0;
+
+#ifdef CROPDETECTOR_SSE
+    const __m128i zero = _mm_setzero_si128();
+    __m128i total = zero;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+        total = _mm_add_epi64(total, _mm_sad_epu8(pixels, zero));
+
+        const __m128i low = _mm_unpacklo_epi8(pixels, zero);
+        const __m128i high = _mm_unpackhi_epi8(pixels, zero);
+        __m128i *column = reinterpret_cast<__m128i *>(columns + x);
+        _mm_storeu_si128(column, _mm_add_epi32(_mm_loadu_si128(column), _mm_unpacklo_epi16(low, zero)));
+        _mm_storeu_si128(column + 1, _mm_add_epi32(_mm_loadu_si128(column + 1), _mm_unpackhi_epi16(low, zero)));
+        _mm_storeu_si128(column + 2, _mm_add_epi32(_mm_loadu_si128(column + 2), _mm_unpacklo_epi16(high, zero)));
+        _mm_storeu_si128(column + 3, _mm_add_epi32(_mm_loadu_si128(column + 3), _mm_unpackhi_epi16(high, zero)));
+    }
+    sum = quint32(_mm_cvtsi128_si32(total)) + quint32(_mm_cvtsi128_si32(_mm_srli_si128(total, 8)));
+#endif
+
+    for (; x < width; ++x) {
+        sum += row[x];
+        columns[x] += row[x];
+    }
+    return sum;
+}
+
+QRect activeArea(const LumaPlane &plane)
+{
+    std::vector<quint32> columns(plane.width, 0);
+    std::vector<quint32> rows(plane.height, 0);
+
+    for (int y = 0; y < plane.height; ++y) {
+        const uchar *row = plane.data + qsizetype(y) * plane.stride;
+        if (plane.step == 1) {
+            rows[y] = accumulateRow(row, plane.width, columns.data());
+        } else {
+            quint32 sum = 0;
+            for (int x = 0; x < plane.width; ++x) {
+                const quint32 value = plane.tenBit ? qFromLittleEndian<quint16>(row + x * 2) >> 2 : row[x * plane.step];
+                sum += value;
+                columns[x] += value;
+            }
+            rows[y] = sum;
+        }
+    }
+
+    const quint32 rowLimit = ACTIVE_LUMA * quint32(plane.width);
+    const quint32 columnLimit = ACTIVE_LUMA * quint32(plane.height);
+
+    int top = 0;
+    while (top < plane.height && rows[top] <= rowLimit) {
+        ++top;
+    }
+    if (top == plane.height) {
+        return QRect();
+    }
+
+    int bottom = plane.height - 1;
+    while (bottom > top && rows[bottom] <= rowLimit) {
+        --bottom;
+    }
+
+    int left = 0;
+    while (left < plane.width && columns[left] <= columnLimit) {
+        ++left;
+    }
+    if (left == plane.width) {
+        return QRect();
+    }
+
+    int right = plane.width - 1;
+    while (right > left && columns[right] <= columnLimit) {
+        --right;
+    }
+
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+}
+
+CropDetector::CropDetector(QObject *parent)
+    : QObject(parent), m_active(false), m_nextSample(0), m_generation(0), m_busy(false), m_samples(0),
+    m_hasCrop(false)
+{
+    m_clock.start();
+}
+
+CropDetector::~CropDetector()
+{
+    disconnectSink();
+
+    QMutexLocker locker(&m_taskMutex);
+    m_task.waitForFinished();
+}
+
+void CropDetector::setActive(bool active)
+{
+    if (m_active == active) {
+        return;
+    }
+
+    m_active = active;
+
+    if (m_active) {
+        onSourceChanged();
+        connectSink();
+    } else {
+        disconnectSink();
+        clearCrop();
+    }
+
+    emit activeChanged();
+}
+
+void CropDetector::setVideoSink(QVideoSink *sink)
+{
+    if (m_videoSink == sink) {
+        return;
+    }
+
+    disconnectSink();
+    m_videoSink = sink;
+    connectSink();
+
+    emit videoSinkChanged();
+}
+
+void CropDetector::setPlayer(QMediaPlayer *player)
+{
+    if (m_player == player) {
+        return;
+    }
+
+    if (m_player) {
+        disconnect(m_player, nullptr, this, nullptr);
+    }
+
+    m_player = player;
+
+    if (m_player) {
+        connect(m_player, &QMediaPlayer::sourceChanged, this, &CropDetector::onSourceChanged);
+    }
+    onSourceChanged();
+
+    emit playerChanged();
+}
+
+QRectF CropDetector::cropRect() const
+{
+    if (!m_hasCrop || m_frameSize.isEmpty()) {
+        return QRectF(0, 0, 1, 1);
+    }
+
+    return QRectF(double(m_crop.x()) / m_frameSize.width(), double(m_crop.y()) / m_frameSize.height(),
+                  double(m_crop.width()) / m_frameSize.width(), double(m_crop.height()) / m_frameSize.height());
+}
+
+QSize CropDetector::croppedSize() const
+{
+    return m_hasCrop ? m_crop.size() : m_frameSize;
+}
+
+void CropDetector::connectSink()
+{
+    if (!m_active || !m_videoSink || m_frameConnection) {
+        return;
+    }
+
+    // Direct connection: frames that are not sampled cost one clock read on the sink thread
+    m_frameConnection = connect(m_videoSink, &QVideoSink::videoFrameChanged, this,
+                                [this](const QVideoFrame &frame) { onVideoFrame(frame); },
+                                Qt::DirectConnection);
+}
+
+void CropDetector::disconnectSink()
+{
+    if (m_frameConnection) {
+        disconnect(m_frameConnection);
+        m_frameConnection = {};
+    }
+}
+
+void CropDetector::onVideoFrame(const QVideoFrame &frame)
+{
+    const qint64 now = m_clock.elapsed();
+    if (now < m_nextSample.load(std::memory_order_relaxed) || !frame.isValid() ||
+        frame.rotation() != QtVideo::Rotation::None) {
+        return;
+    }
+
+    if (m_busy.exchange(true, std::memory_order_acquire)) {
+        return;
+    }
+    m_nextSample.store(now + SAMPLE_INTERVAL_MS, std::memory_order_relaxed);
+
+    const quint32 generation = m_generation.load(std::memory_order_relaxed);
+    QMutexLocker locker(&m_taskMutex);
+    m_task = QtConcurrent::run([this, frame, generation]() {
+        const QRect area = scanFrame(frame);
+        const QSize frameSize = frame.size();
+        QMetaObject::invokeMethod(this, [this, generation, frameSize, area]() {
+            applySample(generation, frameSize, area);
+        }, Qt::QueuedConnection);
+        m_busy.store(false, std::memory_order_release);
+    });
+}
+
+QRect CropDetector::scanFrame(QVideoFrame frame)
+{
+    if (!frame.map(QVideoFrame::ReadOnly)) {
+        return QRect();
+    }
+
+    QRect area;
+    LumaPlane plane;
+    if (lumaPlane(frame, plane)) {
+        area = activeArea(plane);
+    }
+
+    frame.unmap();
+    return area;
+}
+
+void CropDetector::applySample(quint32 generation, const QSize &frameSize, const QRect &area)
+{
+    if (generation != m_generation.load(std::memory_order_relaxed) || frameSize.isEmpty()) {
+        return;
+    }
+
+    if (frameSize != m_frameSize) {
+        m_frameSize = frameSize;
+        m_area = QRect();
+        m_samples = 0;
+        clearCrop();
+    }
+
+    // Fully dark frames say nothing about where the picture ends
+    if (area.isEmpty()) {
+        return;
+    }
+
+    m_area = m_area.isNull() ? area : m_area.united(area);
+    ++m_samples;
+
+    if (!m_source.isEmpty()) {
+        s_cache.insert(m_source, {m_frameSize, m_area, m_samples});
+    }
+
+    if (m_samples >= MIN_SAMPLES) {
+        publish();
+    }
+}
+
+void CropDetector::onSourceChanged()
+{
+    m_generation.fetch_add(1, std::memory_order_relaxed);
+    m_nextSample.store(0, std::memory_order_relaxed);
+    m_source = m_player ? m_player->source().toString() : QString();
+    m_frameSize = QSize();
+    m_area = QRect();
+    m_samples = 0;
+
+    auto cached = s_cache.constFind(m_source);
+    if (m_active && cached != s_cache.cend()) {
+        m_frameSize = cached->frameSize;
+        m_area = cached->area;
+        m_samples = cached->samples;
+        if (m_samples >= MIN_SAMPLES) {
+            publish();
+            return;
+        }
+    }
+
+    clearCrop();
+}
+
+void CropDetector::publish()
+{
+    QRect crop(QPoint(0, 0), m_frameSize);
+
+    // Ignore slivers, encoders often leave a line or two of black at the edges
+    const int minHorizontal = m_frameSize.width() * MIN_CROP_PERCENT / 100;
+    const int minVertical = m_frameSize.height() * MIN_CROP_PERCENT / 100;
+    if (m_area.left() > minHorizontal || m_frameSize.width() - 1 - m_area.right() > minHorizontal) {
+        crop.setLeft(m_area.left());
+        crop.setRight(m_area.right());
+    }
+    if (m_area.top() > minVertical || m_frameSize.height() - 1 - m_area.bottom() > minVertical) {
+        crop.setTop(m_area.top());
+        crop.setBottom(m_area.bottom());
+    }
+
+    const bool hasCrop = crop.size() != m_frameSize;
+    if (hasCrop == m_hasCrop && crop == m_crop) {
+        return;
+    }
+
+    m_hasCrop = hasCrop;
+    m_crop = crop;
+    emit cropChanged();
+}
+
+void CropDetector::clearCrop()
+{
+    if (!m_hasCrop && m_crop.isNull()) {
+        return;
+    }
+
+    m_hasCrop = false;
+    m_crop = QRect();
+    emit cropChanged();
+}
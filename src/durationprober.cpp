@@ -0,0 +1,665 @@
+#include "durationprober.h"
+#include "archivereader.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QTimeZone>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtEndian>
+#include <bit>
+#include <cstring>
+
+namespace {
+
+const int NOTIFY_INTERVAL_MS = 100;
+const int MAX_ELEMENTS = 4096;
+const qint64 MP3_SYNC_SCAN = 64 * 1024;
+const qint64 OGG_TAIL_SCAN = 64 * 1024;
+
+const uchar ASF_HEADER_GUID[16] = {0x30, 0x26, 0xB2, 0x75, 0x8E, 0x66, 0xCF, 0x11,
+                                   0xA6, 0xD9, 0x00, 0xAA, 0x00, 0x62, 0xCE, 0x6C};
+const uchar ASF_FILE_PROPERTIES_GUID[16] = {0xA1, 0xDC, 0xAB, 0x8C, 0x47, 0xA9, 0xCF, 0x11,
+                                            0x8E, 0xE4, 0x00, 0xC0, 0x0C, 0x20, 0x53, 0x65};
+
+QByteArray readAt(QIODevice &device, qint64 pos, qint64 length)
+{
+    if (pos < 0 || !device.seek(pos)) {
+        return QByteArray();
+    }
+    return device.read(length);
+}
+
+const uchar *bytes(const QByteArray &data)
+{
+    return reinterpret_cast<const uchar *>(data.constData());
+}
+
+qint64 toMs(quint64 units, quint64 unitsPerSecond)
+{
+    if (unitsPerSecond == 0) {
+        return -1;
+    }
+    // Split to keep 64-bit sample counts from overflowing
+    return qint64(units / unitsPerSecond * 1000 + units % unitsPerSecond * 1000 / unitsPerSecond);
+}
+
+qint64 id3Size(QIODevice &device)
+{
+    const QByteArray header = readAt(device, 0, 10);
+    if (header.size() < 10 || !header.startsWith("ID3")) {
+        return 0;
+    }
+
+    const uchar *h = bytes(header);
+    const qint64 size = (qint64(h[6] & 0x7f) << 21) | (qint64(h[7] & 0x7f) << 14) | (qint64(h[8] & 0x7f) << 7) |
+                        qint64(h[9] & 0x7f);
+    return 10 + size + ((h[5] & 0x10) ? 10 : 0);
+}
+
+// MP4: mvhd holds the movie duration, fragmented files may only have it in mvex/mehd
+
+void readMp4Boxes(QIODevice &device, qint64 pos, qint64 end, int depth, quint64 &timescale, quint64 &duration,
+                  quint64 &fragmentDuration)
+{
+    for (int count = 0; pos + 8 <= end && count < MAX_ELEMENTS; ++count) {
+        const QByteArray header = readAt(device, pos, 16);
+        if (header.size() < 8) {
+            return;
+        }
+
+        qint64 size = qFromBigEndian<quint32>(bytes(header));
+        const QByteArray type = header.mid(4, 4);
+        qint64 headerSize = 8;
+        if (size == 1) {
+            if (header.size() < 16) {
+                return;
+            }
+            size = qint64(qFromBigEndian<quint64>(bytes(header) + 8));
+            headerSize = 16;
+        } else if (size == 0) {
+            size = end - pos;
+        }
+        if (size < headerSize || pos + size > end) {
+            return;
+        }
+
+        const qint64 body = pos + headerSize;
+        if (depth == 0 && type == "moov") {
+            readMp4Boxes(device, body, pos + size, 1, timescale, duration, fragmentDuration);
+            return;
+        } else if (depth == 1 && type == "mvex") {
+            readMp4Boxes(device, body, pos + size, 2, timescale, duration, fragmentDuration);
+        } else if (depth == 1 && type == "mvhd") {
+            const QByteArray data = readAt(device, body, 32);
+            const uchar *d = bytes(data);
+            if (data.size() >= 20 && d[0] == 0) {
+                timescale = qFromBigEndian<quint32>(d + 12);
+                const quint32 value = qFromBigEndian<quint32>(d + 16);
+                duration = value == 0xffffffffu ? 0 : value;
+            } else if (data.size() >= 32 && d[0] == 1) {
+                timescale = qFromBigEndian<quint32>(d + 20);
+                const quint64 value = qFromBigEndian<quint64>(d + 24);
+                duration = value == ~quint64(0) ? 0 : value;
+            }
+        } else if (depth == 2 && type == "mehd") {
+            const QByteArray data = readAt(device, body, 12);
+            const uchar *d = bytes(data);
+            if (data.size() >= 8 && d[0] == 0) {
+                fragmentDuration = qFromBigEndian<quint32>(d + 4);
+            } else if (data.size() >= 12 && d[0] == 1) {
+                fragmentDuration = qFromBigEndian<quint64>(d + 4);
+            }
+        }
+
+        pos += size;
+    }
+}
+
+qint64 readMp4Duration(QIODevice &device)
+{
+    quint64 timescale = 0;
+    quint64 duration = 0;
+    quint64 fragmentDuration = 0;
+    readMp4Boxes(device, 0, device.size(), 0, timescale, duration, fragmentDuration);
+    return toMs(duration > 0 ? duration : fragmentDuration, timescale);
+}
+
+// Matroska: Segment > Info > TimecodeScale and Duration, Info precedes the clusters
+
+bool readEbmlVint(QIODevice &device, qint64 &pos, quint64 &value, bool keepMarker)
+{
+    const QByteArray first = readAt(device, pos, 1);
+    if (first.isEmpty() || uchar(first.at(0)) == 0) {
+        return false;
+    }
+
+    const uchar lead = uchar(first.at(0));
+    const int length = std::countl_zero(lead) + 1;
+    const QByteArray data = length > 1 ? device.read(length - 1) : QByteArray();
+    if (data.size() != length - 1) {
+        return false;
+    }
+
+    value = keepMarker ? lead : (lead & (0xff >> length));
+    bool allOnes = value == quint64(0xff >> length);
+    for (int i = 0; i < length - 1; ++i) {
+        value = (value << 8) | uchar(data.at(i));
+        allOnes = allOnes && uchar(data.at(i)) == 0xff;
+    }
+    if (!keepMarker && allOnes) {
+        // Unknown size, the element runs to the end of its parent
+        value = ~quint64(0);
+    }
+
+    pos += length;
+    return true;
+}
+
+qint64 readMatroskaDuration(QIODevice &device)
+{
+    const qint64 fileSize = device.size();
+    qint64 pos = 0;
+    quint64 id = 0;
+    quint64 size = 0;
+
+    if (!readEbmlVint(device, pos, id, true) || id != 0x1A45DFA3 || !readEbmlVint(device, pos, size, false) ||
+        size == ~quint64(0)) {
+        return -1;
+    }
+    pos += qint64(size);
+
+    if (!readEbmlVint(device, pos, id, true) || id != 0x18538067 || !readEbmlVint(device, pos, size, false)) {
+        return -1;
+    }
+    const qint64 segmentEnd = size == ~quint64(0) ? fileSize : qMin(fileSize, pos + qint64(size));
+
+    for (int count = 0; pos < segmentEnd && count < MAX_ELEMENTS; ++count) {
+        if (!readEbmlVint(device, pos, id, true) || !readEbmlVint(device, pos, size, false) || size == ~quint64(0)) {
+            return -1;
+        }
+        if (id == 0x1F43B675) {
+            return -1;
+        }
+        if (id != 0x1549A966) {
+            pos += qint64(size);
+            continue;
+        }
+
+        const qint64 infoEnd = qMin(segmentEnd, pos + qint64(size));
+        quint64 timecodeScale = 1000000;
+        double duration = -1;
+        while (pos < infoEnd) {
+            quint64 childId = 0;
+            quint64 childSize = 0;
+            if (!readEbmlVint(device, pos, childId, true) || !readEbmlVint(device, pos, childSize, false) ||
+                childSize == ~quint64(0)) {
+                break;
+            }
+
+            // Numbers are at most 8 bytes, titles and app names are skipped unread
+            const QByteArray data = childSize <= 8 ? readAt(device, pos, qint64(childSize)) : QByteArray();
+            if (childId == 0x2AD7B1 && data.size() > 0) {
+                timecodeScale = 0;
+                for (char c : data) {
+                    timecodeScale = (timecodeScale << 8) | uchar(c);
+                }
+            } else if (childId == 0x4489 && data.size() == 4) {
+                duration = std::bit_cast<float>(qFromBigEndian<quint32>(bytes(data)));
+            } else if (childId == 0x4489 && data.size() == 8) {
+                duration = std::bit_cast<double>(qFromBigEndian<quint64>(bytes(data)));
+            }
+            pos += qint64(childSize);
+        }
+
+        return duration > 0 ? qint64(duration * double(timecodeScale) / 1e6) : -1;
+    }
+
+    return -1;
+}
+
+// FLAC: STREAMINFO is always the first metadata block
+
+qint64 readFlacDuration(QIODevice &device, qint64 start)
+{
+    const QByteArray data = readAt(device, start, 4 + 4 + 34);
+    if (data.size() < 42 || !data.startsWith("fLaC") || (uchar(data.at(4)) & 0x7f) != 0) {
+        return -1;
+    }
+
+    const uchar *info = bytes(data) + 8;
+    const quint32 sampleRate = (quint32(info[10]) << 12) | (quint32(info[11]) << 4) | (info[12] >> 4);
+    const quint64 samples = (quint64(info[13] & 0x0f) << 32) | qFromBigEndian<quint32>(info + 14);
+    return samples > 0 ? toMs(samples, sampleRate) : -1;
+}
+
+// MP3: frame count from the Xing/Info or VBRI header, otherwise the first frame's bitrate
+
+struct Mp3Frame
+{
+    int bitrate = 0;
+    int sampleRate = 0;
+    int samplesPerFrame = 0;
+    int length = 0;
+    int sideInfoSize = 0;
+};
+
+bool parseMp3Header(const uchar *h, Mp3Frame &frame)
+{
+    static const int bitrates[5][15] = {
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+    };
+    static const int sampleRates[3] = {44100, 48000, 32000};
+
+    if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0) {
+        return false;
+    }
+
+    const int version = (h[1] >> 3) & 3;
+    const int layer = (h[1] >> 1) & 3;
+    const int bitrateIndex = h[2] >> 4;
+    const int sampleRateIndex = (h[2] >> 2) & 3;
+    if (version == 1 || layer == 0 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3) {
+        return false;
+    }
+
+    const bool mpeg1 = version == 3;
+    const bool mono = (h[3] >> 6) == 3;
+    const int padding = (h[2] >> 1) & 1;
+    const int table = mpeg1 ? 3 - layer : (layer == 3 ? 3 : 4);
+
+    frame.bitrate = bitrates[table][bitrateIndex] * 1000;
+    frame.sampleRate = sampleRates[sampleRateIndex] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    frame.samplesPerFrame = layer == 3 ? 384 : (layer == 2 || mpeg1 ? 1152 : 576);
+    frame.length = layer == 3 ? (12 * frame.bitrate / frame.sampleRate + padding) * 4
+                              : frame.samplesPerFrame / 8 * frame.bitrate / frame.sampleRate + padding;
+    frame.sideInfoSize = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+    return true;
+}
+
+qint64 readMp3Duration(QIODevice &device, qint64 start)
+{
+    const QByteArray data = readAt(device, start, MP3_SYNC_SCAN);
+    const uchar *d = bytes(data);
+    const int size = int(data.size());
+
+    // A sync word only counts if the next frame starts where this one says it ends
+    int offset = -1;
+    Mp3Frame frame;
+    for (int i = 0; i + 4 <= size; ++i) {
+        Mp3Frame next;
+        if (parseMp3Header(d + i, frame) &&
+            (i + frame.length + 4 > size || parseMp3Header(d + i + frame.length, next))) {
+            offset = i;
+            break;
+        }
+    }
+    if (offset < 0) {
+        return -1;
+    }
+
+    const QByteArray header = readAt(device, start + offset, 4 + 32 + 26);
+    const uchar *h = bytes(header);
+    const int xing = 4 + frame.sideInfoSize;
+    if (header.size() >= xing + 12 && (header.mid(xing, 4) == "Xing" || header.mid(xing, 4) == "Info") &&
+        (qFromBigEndian<quint32>(h + xing + 4) & 1)) {
+        return toMs(quint64(qFromBigEndian<quint32>(h + xing + 8)) * frame.samplesPerFrame, frame.sampleRate);
+    }
+    if (header.size() >= 36 + 18 && header.mid(36, 4) == "VBRI") {
+        return toMs(quint64(qFromBigEndian<quint32>(h + 36 + 14)) * frame.samplesPerFrame, frame.sampleRate);
+    }
+
+    qint64 audioBytes = device.size() - start - offset;
+    if (readAt(device, device.size() - 128, 3) == "TAG") {
+        audioBytes -= 128;
+    }
+    return audioBytes > 0 ? toMs(quint64(audioBytes) * 8, quint64(frame.bitrate)) : -1;
+}
+
+// RIFF: WAV data size over the byte rate, AVI frame count times frame duration
+
+qint64 readWavDuration(QIODevice &device)
+{
+    qint64 pos = 12;
+    quint32 byteRate = 0;
+
+    for (int count = 0; count < MAX_ELEMENTS; ++count) {
+        const QByteArray header = readAt(device, pos, 8);
+        if (header.size() < 8) {
+            return -1;
+        }
+
+        const QByteArray id = header.left(4);
+        const quint32 size = qFromLittleEndian<quint32>(bytes(header) + 4);
+        if (id == "fmt ") {
+            const QByteArray format = readAt(device, pos + 8, 12);
+            if (format.size() < 12) {
+                return -1;
+            }
+            byteRate = qFromLittleEndian<quint32>(bytes(format) + 8);
+        } else if (id == "data") {
+            // Streamed files leave the size unset
+            qint64 dataSize = size;
+            if (size == 0 || size == 0xffffffffu || pos + 8 + dataSize > device.size()) {
+                dataSize = device.size() - pos - 8;
+            }
+            return toMs(quint64(dataSize), byteRate);
+        }
+
+        pos += 8 + size + (size & 1);
+    }
+
+    return -1;
+}
+
+qint64 readAviDuration(QIODevice &device)
+{
+    const QByteArray header = readAt(device, 12, 12 + 8 + 20);
+    if (header.size() < 40 || header.mid(0, 4) != "LIST" || header.mid(8, 4) != "hdrl" ||
+        header.mid(12, 4) != "avih") {
+        return -1;
+    }
+
+    const uchar *avih = bytes(header) + 20;
+    const quint64 microsecondsPerFrame = qFromLittleEndian<quint32>(avih);
+    const quint64 frames = qFromLittleEndian<quint32>(avih + 16);
+    return frames > 0 ? qint64(microsecondsPerFrame * frames / 1000) : -1;
+}
+
+// ASF (WMA/WMV): play duration of the File Properties object minus the preroll
+
+qint64 readAsfDuration(QIODevice &device)
+{
+    const QByteArray header = readAt(device, 0, 30);
+    if (header.size() < 30 || memcmp(header.constData(), ASF_HEADER_GUID, 16) != 0) {
+        return -1;
+    }
+
+    const qint64 headerEnd = qint64(qFromLittleEndian<quint64>(bytes(header) + 16));
+    qint64 pos = 30;
+    for (int count = 0; pos + 24 <= headerEnd && count < MAX_ELEMENTS; ++count) {
+        const QByteArray object = readAt(device, pos, 24);
+        if (object.size() < 24) {
+            return -1;
+        }
+
+        const qint64 size = qint64(qFromLittleEndian<quint64>(bytes(object) + 16));
+        if (memcmp(object.constData(), ASF_FILE_PROPERTIES_GUID, 16) == 0) {
+            const QByteArray properties = readAt(device, pos + 24, 68);
+            if (properties.size() < 68) {
+                return -1;
+            }
+
+            const uchar *p = bytes(properties);
+            const quint64 playDuration = qFromLittleEndian<quint64>(p + 40);
+            const quint64 preroll = qFromLittleEndian<quint64>(p + 56);
+            const bool broadcast = qFromLittleEndian<quint32>(p + 64) & 1;
+            if (broadcast || playDuration == 0) {
+                return -1;
+            }
+            return qMax<qint64>(0, qint64(playDuration / 10000) - qint64(preroll));
+        }
+
+        if (size < 24) {
+            return -1;
+        }
+        pos += size;
+    }
+
+    return -1;
+}
+
+// Ogg: granule position of the last page over the rate from the identification header
+
+qint64 readOggDuration(QIODevice &device)
+{
+    const QByteArray page = readAt(device, 0, 27 + 255 + 20);
+    if (page.size() < 28) {
+        return -1;
+    }
+
+    const int packetStart = 27 + uchar(page.at(26));
+    const QByteArray packet = page.mid(packetStart);
+    const uchar *p = bytes(packet);
+    quint64 rate = 0;
+    quint64 preSkip = 0;
+    if (packet.size() >= 16 && packet.startsWith("\x01vorbis")) {
+        rate = qFromLittleEndian<quint32>(p + 12);
+    } else if (packet.size() >= 12 && packet.startsWith("OpusHead")) {
+        // Opus granules always count 48 kHz samples
+        rate = 48000;
+        preSkip = qFromLittleEndian<quint16>(p + 10);
+    } else {
+        return -1;
+    }
+
+    const qint64 tailStart = qMax<qint64>(0, device.size() - OGG_TAIL_SCAN);
+    const QByteArray tail = readAt(device, tailStart, OGG_TAIL_SCAN);
+    for (qsizetype i = tail.lastIndexOf("OggS"); i >= 0; i = i > 0 ? tail.lastIndexOf("OggS", i - 1) : -1) {
+        if (i + 14 > tail.size()) {
+            continue;
+        }
+        const qint64 granule = qFromLittleEndian<qint64>(bytes(tail) + i + 6);
+        if (granule > 0) {
+            return toMs(quint64(granule) > preSkip ? quint64(granule) - preSkip : 0, rate);
+        }
+    }
+
+    return -1;
+}
+
+}
+
+DurationProber::DurationProber(QObject *parent)
+    : QObject(parent), m_dirty(false)
+{
+    m_pool.setThreadPriority(QThread::LowPriority);
+
+    // Results arrive in bursts, listeners recompute sums over the whole playlist
+    m_notifyTimer.setSingleShot(true);
+    m_notifyTimer.setInterval(NOTIFY_INTERVAL_MS);
+    connect(&m_notifyTimer, &QTimer::timeout, this, &DurationProber::durationsChanged);
+
+    connect(&m_watcher, &QFutureWatcherBase::resultsReadyAt, this, &DurationProber::onResultsReady);
+    connect(&m_watcher, &QFutureWatcherBase::finished, this, &DurationProber::onFinished);
+
+    loadCache();
+}
+
+DurationProber::~DurationProber()
+{
+    m_watcher.cancel();
+    m_pool.waitForDone();
+    if (m_dirty) {
+        saveCache();
+    }
+}
+
+void DurationProber::probe(const QStringList &entries)
+{
+    m_watcher.cancel();
+
+    if (entries.isEmpty()) {
+        return;
+    }
+
+    // Only the cache is looked up here, files are stat'ed on the pool
+    QList<Probe> pending;
+    pending.reserve(entries.size());
+    for (const QString &entry : entries) {
+        Probe probe;
+        probe.entry = entry;
+        probe.result = m_cache.value(entry);
+        pending.append(probe);
+    }
+
+    m_watcher.setFuture(QtConcurrent::mapped(&m_pool, pending, [](const Probe &cached) {
+        Probe probe;
+        probe.entry = cached.entry;
+        probe.result = fileStamp(cached.entry);
+        if (probe.result.size == cached.result.size && probe.result.modified == cached.result.modified) {
+            return cached;
+        }
+
+        probe.result.duration = readDuration(cached.entry);
+        probe.changed = true;
+        return probe;
+    }));
+}
+
+qint64 DurationProber::duration(const QString &entry) const
+{
+    auto cached = m_cache.constFind(entry);
+    return cached != m_cache.cend() ? cached->duration : -1;
+}
+
+qint64 DurationProber::readDuration(const QString &entry)
+{
+    QString archivePath;
+    QString memberName;
+    if (entry.startsWith("file://") && ArchiveIndex::splitMemberUrl(QUrl(entry), archivePath, memberName)) {
+        ArchiveMember member;
+        if (!ArchiveIndex::findMember(archivePath, memberName, member)) {
+            return -1;
+        }
+        ArchiveMemberDevice device(archivePath, member);
+        return device.open(QIODevice::ReadOnly) ? readDuration(device) : -1;
+    }
+
+    QFile file(entry);
+    return file.open(QIODevice::ReadOnly) ? readDuration(file) : -1;
+}
+
+qint64 DurationProber::readDuration(QIODevice &device)
+{
+    const QByteArray magic = readAt(device, 0, 16);
+    if (magic.size() < 12) {
+        return -1;
+    }
+
+    const QByteArray boxType = magic.mid(4, 4);
+    if (boxType == "ftyp" || boxType == "moov" || boxType == "mdat" || boxType == "free" || boxType == "wide") {
+        return readMp4Duration(device);
+    }
+    if (qFromBigEndian<quint32>(bytes(magic)) == 0x1A45DFA3) {
+        return readMatroskaDuration(device);
+    }
+    if (magic.startsWith("RIFF") && magic.mid(8, 4) == "WAVE") {
+        return readWavDuration(device);
+    }
+    if (magic.startsWith("RIFF") && magic.mid(8, 4) == "AVI ") {
+        return readAviDuration(device);
+    }
+    if (magic.startsWith("OggS")) {
+        return readOggDuration(device);
+    }
+    if (magic.size() >= 16 && memcmp(magic.constData(), ASF_HEADER_GUID, 16) == 0) {
+        return readAsfDuration(device);
+    }
+
+    // FLAC and MP3 may both follow an ID3v2 tag
+    const qint64 start = id3Size(device);
+    if (readAt(device, start, 4) == "fLaC") {
+        return readFlacDuration(device, start);
+    }
+    return readMp3Duration(device, start);
+}
+
+void DurationProber::onResultsReady(int begin, int end)
+{
+    bool changed = false;
+    for (int i = begin; i < end; ++i) {
+        const Probe probe = m_watcher.resultAt(i);
+        if (probe.changed) {
+            m_cache.insert(probe.entry, probe.result);
+            changed = true;
+        }
+    }
+
+    if (!changed) {
+        return;
+    }
+
+    m_dirty = true;
+    if (!m_notifyTimer.isActive()) {
+        m_notifyTimer.start();
+    }
+}
+
+void DurationProber::onFinished()
+{
+    if (m_dirty) {
+        saveCache();
+        m_dirty = false;
+    }
+}
+
+DurationProber::Entry DurationProber::fileStamp(const QString &entry)
+{
+    QString path = entry;
+    QString memberName;
+    if (entry.startsWith("file://") && !ArchiveIndex::splitMemberUrl(QUrl(entry), path, memberName)) {
+        path = QUrl(entry).toLocalFile();
+    }
+
+    // Archive members change with their archive
+    const QFileInfo info(path);
+    Entry stamp;
+    stamp.size = info.size();
+    stamp.modified = info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+    return stamp;
+}
+
+QString DurationProber::cachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/durations.json";
+}
+
+void DurationProber::loadCache()
+{
+    QFile file(cachePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
+        const QJsonObject object = it.value().toObject();
+        Entry entry;
+        entry.size = object.value("size").toInteger(-1);
+        entry.modified = object.value("modified").toInteger(-1);
+        entry.duration = object.value("duration").toInteger(-1);
+        m_cache.insert(it.key(), entry);
+    }
+}
+
+void DurationProber::saveCache() const
+{
+    QJsonObject root;
+    for (auto it = m_cache.cbegin(); it != m_cache.cend(); ++it) {
+        QJsonObject object;
+        object.insert("size", it->size);
+        object.insert("modified", it->modified);
+        object.insert("duration", it->duration);
+        root.insert(it.key(), object);
+    }
+
+    const QString path = cachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
@@ -0,0 +1,662 @@
+#include "episodemarkers.h"
+#include "realfft.h"
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QAudioFormat>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QTimeZone>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const int SAMPLE_RATE = 11025;
+const int FRAME_SIZE = 2048;
+const int HOP_SIZE = 1024;
+const int HEAD_FRAMES = 300 * SAMPLE_RATE / HOP_SIZE;
+const int TAIL_FRAMES = 300 * SAMPLE_RATE / HOP_SIZE;
+const int MIN_SEGMENT_FRAMES = 15 * SAMPLE_RATE / HOP_SIZE;
+const int MAX_GAP_FRAMES = 10;
+const int MAX_BIT_ERRORS = 5;
+const int NEIGHBOURS = 2;
+const float MIN_CHROMA_HZ = 110.0f;
+const float MAX_CHROMA_HZ = 3520.0f;
+const float SILENCE_POWER = 0.5f;
+
+// Hashes of audible frames carry this bit, silence never matches anything
+const quint32 VALID_BIT = 0x80000000u;
+const quint32 HASH_MASK = 0x00ffffffu;
+
+const quint32 FINGERPRINT_MAGIC = 0x45504650;
+const quint32 FINGERPRINT_VERSION = 1;
+
+qint64 framesToMs(qint64 frames)
+{
+    return frames * HOP_SIZE * 1000 / SAMPLE_RATE;
+}
+
+template <typename T>
+void downmix(const uchar *data, int frames, int channels, float scale, float offset, float *out)
+{
+    const float gain = scale / channels;
+    for (int frame = 0; frame < frames; ++frame) {
+        float sum = 0;
+        for (int channel = 0; channel < channels; ++channel) {
+            sum += float(qFromUnaligned<T>(data)) - offset;
+            data += sizeof(T);
+        }
+        out[frame] = sum * gain;
+    }
+}
+
+/**
+ * Reduces a stream of audio to one hash per hop: 12 bits comparing adjacent
+ * pitch classes and 12 bits comparing each class with the previous frame.
+ */
+class ChromaHasher
+{
+public:
+    ChromaHasher()
+        : m_fft(FRAME_SIZE), m_window(FRAME_SIZE), m_frame(FRAME_SIZE), m_power(FRAME_SIZE / 2),
+        m_pitchClass(FRAME_SIZE / 2, -1), m_tail(TAIL_FRAMES), m_frames(0), m_tailStart(0), m_endFrame(0), m_samples(0),
+        m_phase(0), m_last(0)
+    {
+        m_previous.fill(0.0f);
+        m_pending.reserve(FRAME_SIZE + HOP_SIZE);
+
+        for (int i = 0; i < FRAME_SIZE; ++i) {
+            m_window[i] = float(0.5 - 0.5 * std::cos(2.0 * 3.14159265358979323846 * i / (FRAME_SIZE - 1)));
+        }
+
+        for (int bin = 1; bin < FRAME_SIZE / 2; ++bin) {
+            const float frequency = float(bin) * SAMPLE_RATE / FRAME_SIZE;
+            if (frequency >= MIN_CHROMA_HZ && frequency < MAX_CHROMA_HZ) {
+                const int note = int(std::lround(12.0 * std::log2(frequency / 440.0)));
+                m_pitchClass[bin] = ((note % 12) + 12) % 12;
+            }
+        }
+    }
+
+    void addBuffer(const QAudioBuffer &buffer)
+    {
+        const QAudioFormat format = buffer.format();
+        const int channels = format.channelCount();
+        const int frames = int(buffer.frameCount());
+        if (channels <= 0 || frames <= 0) {
+            return;
+        }
+
+        m_mono.resize(frames);
+        const uchar *data = buffer.constData<uchar>();
+        switch (format.sampleFormat()) {
+        case QAudioFormat::UInt8:
+            downmix<quint8>(data, frames, channels, 1.0f / 128, 128, m_mono.data());
+            break;
+        case QAudioFormat::Int16:
+            downmix<qint16>(data, frames, channels, 1.0f / 32768, 0, m_mono.data());
+            break;
+        case QAudioFormat::Int32:
+            downmix<qint32>(data, frames, channels, 1.0f / 2147483648.0f, 0, m_mono.data());
+            break;
+        case QAudioFormat::Float:
+            downmix<float>(data, frames, channels, 1.0f, 0, m_mono.data());
+            break;
+        default:
+            return;
+        }
+
+        if (format.sampleRate() == SAMPLE_RATE) {
+            for (int i = 0; i < frames; ++i) {
+                addSample(m_mono[i]);
+            }
+            return;
+        }
+
+        // Linear resampling in case the decoder ignored the requested rate,
+        // position -1 stands for the last sample of the previous buffer
+        const double step = double(format.sampleRate()) / SAMPLE_RATE;
+        while (m_phase < frames - 1) {
+            const int index = int(std::floor(m_phase));
+            const float fraction = float(m_phase - index);
+            const float first = index < 0 ? m_last : m_mono[index];
+            addSample(first + (m_mono[index + 1] - first) * fraction);
+            m_phase += step;
+        }
+        m_phase -= frames;
+        m_last = m_mono[frames - 1];
+    }
+
+    /**
+     * Anchors the tail window to the end of a stream of the given length.
+     * Frames between the head and the tail are then skipped, and the stream
+     * is complete once the tail window is filled.
+     */
+    void setDuration(qint64 ms)
+    {
+        const qint64 frames = ms * SAMPLE_RATE / 1000 / HOP_SIZE;
+        m_tailStart = qMax<qint64>(0, frames - TAIL_FRAMES);
+        m_endFrame = frames;
+    }
+
+    bool isComplete() const { return m_endFrame > 0 && m_frames >= m_endFrame; }
+
+    qint64 durationMs() const { return m_samples * 1000 / SAMPLE_RATE; }
+    const QList<quint32> &head() const { return m_head; }
+
+    QList<quint32> tail() const
+    {
+        const qint64 count = qMin<qint64>(m_frames, TAIL_FRAMES);
+        QList<quint32> ordered;
+        ordered.reserve(count);
+        for (qint64 i = m_frames - count; i < m_frames; ++i) {
+            ordered.append(m_tail[i % TAIL_FRAMES]);
+        }
+        return ordered;
+    }
+
+private:
+    void addSample(float sample)
+    {
+        ++m_samples;
+        m_pending.push_back(sample);
+        if (int(m_pending.size()) < FRAME_SIZE) {
+            return;
+        }
+
+        // The frame just before the tail is still hashed, later frames compare against it
+        if (m_frames >= HEAD_FRAMES && m_frames + 1 < m_tailStart) {
+            m_pending.erase(m_pending.begin(), m_pending.begin() + HOP_SIZE);
+            m_tail[m_frames % TAIL_FRAMES] = 0;
+            ++m_frames;
+            return;
+        }
+
+        for (int i = 0; i < FRAME_SIZE; ++i) {
+            m_frame[i] = m_pending[i] * m_window[i];
+        }
+        m_pending.erase(m_pending.begin(), m_pending.begin() + HOP_SIZE);
+
+        m_fft.powerSpectrum(m_frame.data(), m_power.data());
+
+        std::array<float, 12> chroma;
+        chroma.fill(0.0f);
+        float energy = 0;
+        for (int bin = 1; bin < FRAME_SIZE / 2; ++bin) {
+            if (m_pitchClass[bin] >= 0) {
+                chroma[m_pitchClass[bin]] += m_power[bin];
+                energy += m_power[bin];
+            }
+        }
+
+        quint32 hash = 0;
+        if (energy > SILENCE_POWER) {
+            hash = VALID_BIT;
+            for (int c = 0; c < 12; ++c) {
+                if (chroma[c] > chroma[(c + 1) % 12]) {
+                    hash |= 1u << c;
+                }
+                if (chroma[c] > m_previous[c]) {
+                    hash |= 1u << (12 + c);
+                }
+            }
+        }
+        m_previous = chroma;
+
+        if (m_frames < HEAD_FRAMES) {
+            m_head.append(hash);
+        }
+        m_tail[m_frames % TAIL_FRAMES] = hash;
+        ++m_frames;
+    }
+
+    RealFft m_fft;
+    std::vector<float> m_window;
+    std::vector<float> m_frame;
+    std::vector<float> m_power;
+    std::vector<int> m_pitchClass;
+    std::vector<float> m_pending;
+    std::vector<float> m_mono;
+    std::array<float, 12> m_previous;
+    QList<quint32> m_head;
+    std::vector<quint32> m_tail;
+    qint64 m_frames;
+    qint64 m_tailStart;
+    qint64 m_endFrame;
+    qint64 m_samples;
+    double m_phase;
+    float m_last;
+};
+
+struct Segment
+{
+    int startA = 0;
+    int startB = 0;
+    int length = 0;
+};
+
+/**
+ * Longest run of matching hashes over every alignment of the two sequences,
+ * short misses inside a run are tolerated as long as most frames match
+ */
+Segment longestSharedRun(const QList<quint32> &a, const QList<quint32> &b)
+{
+    Segment best;
+    const int n = int(a.size());
+    const int m = int(b.size());
+
+    for (int offset = -(n - 1); offset < m; ++offset) {
+        const int first = qMax(0, -offset);
+        const int last = qMin(n, m - offset);
+        if (last - first < MIN_SEGMENT_FRAMES || last - first <= best.length) {
+            continue;
+        }
+
+        int start = -1;
+        int lastHit = -1;
+        int hits = 0;
+        auto consider = [&]() {
+            const int length = lastHit - start + 1;
+            if (length > best.length && hits * 2 >= length) {
+                best = {start, start + offset, length};
+            }
+        };
+
+        for (int i = first; i < last; ++i) {
+            const quint32 x = a[i];
+            const quint32 y = b[i + offset];
+            const bool hit = (x & y & VALID_BIT) && std::popcount((x ^ y) & HASH_MASK) <= MAX_BIT_ERRORS;
+            if (hit) {
+                if (start < 0) {
+                    start = i;
+                    hits = 0;
+                }
+                lastHit = i;
+                ++hits;
+            } else if (start >= 0 && i - lastHit > MAX_GAP_FRAMES) {
+                consider();
+                start = -1;
+            }
+        }
+        if (start >= 0) {
+            consider();
+        }
+    }
+
+    return best;
+}
+
+}
+
+EpisodeMarkers::EpisodeMarkers(QObject *parent)
+    : QObject(parent), m_cancelled(std::make_shared<std::atomic<bool>>(false))
+{
+    // Leave a core to playback, decoding is not urgent
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    m_pool.setThreadPriority(QThread::LowestPriority);
+
+    connect(&m_fingerprintWatcher, &QFutureWatcherBase::finished, this, &EpisodeMarkers::onFingerprintsReady);
+    connect(&m_matchWatcher, &QFutureWatcherBase::finished, this, &EpisodeMarkers::onMatchingReady);
+
+    loadMarkers();
+}
+
+EpisodeMarkers::~EpisodeMarkers()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void EpisodeMarkers::analyze(const QStringList &filePaths)
+{
+    if (filePaths == m_lastRequest) {
+        return;
+    }
+    m_lastRequest = filePaths;
+
+    cancel();
+
+    bool allKnown = true;
+    for (const QString &filePath : filePaths) {
+        if (!isKnown(filePath)) {
+            allKnown = false;
+            break;
+        }
+    }
+
+    if (filePaths.size() < 2 || allKnown) {
+        return;
+    }
+
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_pending = filePaths;
+
+    std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+    m_fingerprintWatcher.setFuture(QtConcurrent::mapped(&m_pool, m_pending, [cancelled](const QString &filePath) {
+        Fingerprint fingerprint;
+        if (loadFingerprint(filePath, fingerprint)) {
+            return fingerprint;
+        }
+        return computeFingerprint(filePath, *cancelled);
+    }));
+}
+
+EpisodeMarkers::Markers EpisodeMarkers::markers(const QString &filePath) const
+{
+    auto entry = m_entries.constFind(QFileInfo(filePath).absoluteFilePath());
+    if (entry == m_entries.cend() || !isKnown(filePath)) {
+        return Markers();
+    }
+    return entry->markers;
+}
+
+void EpisodeMarkers::onFingerprintsReady()
+{
+    if (m_fingerprintWatcher.isCanceled() || m_cancelled->load()) {
+        return;
+    }
+
+    const QList<Fingerprint> computed = m_fingerprintWatcher.future().results();
+    const QStringList filePaths = m_pending;
+    m_matchWatcher.setFuture(QtConcurrent::run(&m_pool, [filePaths, computed]() {
+        return matchEpisodes(filePaths, computed);
+    }));
+}
+
+void EpisodeMarkers::onMatchingReady()
+{
+    if (m_cancelled->load()) {
+        return;
+    }
+
+    const QHash<QString, Markers> results = m_matchWatcher.result();
+    for (auto it = results.cbegin(); it != results.cend(); ++it) {
+        const QFileInfo info(it.key());
+        Entry entry;
+        entry.size = info.size();
+        entry.modified = info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+        entry.markers = it.value();
+        m_entries.insert(it.key(), entry);
+    }
+
+    saveMarkers();
+    emit markersChanged();
+}
+
+void EpisodeMarkers::cancel()
+{
+    m_cancelled->store(true);
+    m_fingerprintWatcher.cancel();
+    m_pending.clear();
+}
+
+bool EpisodeMarkers::isKnown(const QString &filePath) const
+{
+    const QFileInfo info(filePath);
+    auto entry = m_entries.constFind(info.absoluteFilePath());
+    return entry != m_entries.cend() && entry->size == info.size() &&
+           entry->modified == info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+}
+
+EpisodeMarkers::Fingerprint EpisodeMarkers::computeFingerprint(const QString &filePath,
+                                                               const std::atomic<bool> &cancelled)
+{
+    Fingerprint fingerprint;
+    if (cancelled.load()) {
+        return fingerprint;
+    }
+
+    const QFileInfo info(filePath);
+    QAudioFormat format;
+    format.setSampleRate(SAMPLE_RATE);
+    format.setChannelCount(1);
+    format.setSampleFormat(QAudioFormat::Float);
+
+    ChromaHasher hasher;
+    bool failed = false;
+    bool done = false;
+
+    // The decoder reports through queued signals, so it gets an event loop of its own on this pool thread
+    QAudioDecoder decoder;
+    QEventLoop loop;
+    decoder.setAudioFormat(format);
+    decoder.setSource(QUrl::fromLocalFile(info.absoluteFilePath()));
+
+    QObject::connect(&decoder, &QAudioDecoder::durationChanged, &loop, [&](qint64 duration) {
+        if (duration > 0) {
+            hasher.setDuration(duration);
+        }
+    });
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&]() {
+        while (decoder.bufferAvailable() && !hasher.isComplete()) {
+            hasher.addBuffer(decoder.read());
+        }
+        if (cancelled.load() || hasher.isComplete()) {
+            failed = cancelled.load();
+            done = true;
+            decoder.stop();
+            loop.quit();
+        }
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, [&]() {
+        done = true;
+        loop.quit();
+    });
+    QObject::connect(&decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), &loop,
+                     [&](QAudioDecoder::Error) {
+                         qWarning() << "Could not decode audio for episode markers:" << filePath << decoder.errorString();
+                         failed = true;
+                         done = true;
+                         loop.quit();
+                     });
+
+    decoder.start();
+    if (!done) {
+        loop.exec();
+    }
+
+    if (failed || hasher.head().isEmpty()) {
+        return fingerprint;
+    }
+
+    fingerprint.filePath = info.absoluteFilePath();
+    fingerprint.size = info.size();
+    fingerprint.modified = info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+    fingerprint.durationMs = hasher.durationMs();
+    fingerprint.head = hasher.head();
+    fingerprint.tail = hasher.tail();
+
+    saveFingerprint(fingerprint);
+    return fingerprint;
+}
+
+QHash<QString, EpisodeMarkers::Markers> EpisodeMarkers::matchEpisodes(const QStringList &filePaths,
+                                                                      const QList<Fingerprint> &computed)
+{
+    QHash<QString, Fingerprint> byPath;
+    for (const Fingerprint &fingerprint : computed) {
+        if (fingerprint.size >= 0) {
+            byPath.insert(fingerprint.filePath, fingerprint);
+        }
+    }
+
+    QList<Fingerprint> episodes;
+    for (const QString &filePath : filePaths) {
+        episodes.append(byPath.value(QFileInfo(filePath).absoluteFilePath()));
+    }
+
+    const int count = int(episodes.size());
+    std::vector<Segment> intros(count);
+    std::vector<Segment> credits(count);
+
+    auto keepLonger = [](Segment &current, int start, int length) {
+        if (length > current.length) {
+            current.startA = start;
+            current.length = length;
+        }
+    };
+
+    // Episodes are compared with their closest neighbours in playlist order
+    for (int i = 0; i < count; ++i) {
+        if (episodes[i].size < 0) {
+            continue;
+        }
+        for (int j = i + 1; j < qMin(count, i + 1 + NEIGHBOURS); ++j) {
+            if (episodes[j].size < 0) {
+                continue;
+            }
+
+            const Segment intro = longestSharedRun(episodes[i].head, episodes[j].head);
+            if (intro.length >= MIN_SEGMENT_FRAMES) {
+                keepLonger(intros[i], intro.startA, intro.length);
+                keepLonger(intros[j], intro.startB, intro.length);
+            }
+
+            const Segment credit = longestSharedRun(episodes[i].tail, episodes[j].tail);
+            if (credit.length >= MIN_SEGMENT_FRAMES) {
+                keepLonger(credits[i], credit.startA, credit.length);
+                keepLonger(credits[j], credit.startB, credit.length);
+            }
+        }
+    }
+
+    QHash<QString, Markers> results;
+    for (int i = 0; i < count; ++i) {
+        const Fingerprint &episode = episodes[i];
+        if (episode.size < 0) {
+            continue;
+        }
+
+        Markers markers;
+        if (intros[i].length > 0) {
+            markers.introStart = framesToMs(intros[i].startA);
+            markers.introEnd = framesToMs(intros[i].startA + intros[i].length);
+        }
+        if (credits[i].length > 0) {
+            const qint64 tailStart = qMax<qint64>(0, episode.durationMs - framesToMs(episode.tail.size()));
+            markers.creditsStart = tailStart + framesToMs(credits[i].startA);
+            markers.creditsEnd = qMin(episode.durationMs, tailStart + framesToMs(credits[i].startA + credits[i].length));
+        }
+        results.insert(episode.filePath, markers);
+    }
+
+    return results;
+}
+
+bool EpisodeMarkers::loadFingerprint(const QString &filePath, Fingerprint &fingerprint)
+{
+    QFile file(fingerprintPath(filePath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != FINGERPRINT_MAGIC || version != FINGERPRINT_VERSION) {
+        return false;
+    }
+
+    const QFileInfo info(filePath);
+    stream >> fingerprint.size >> fingerprint.modified >> fingerprint.durationMs >> fingerprint.head >> fingerprint.tail;
+    if (stream.status() != QDataStream::Ok || fingerprint.size != info.size() ||
+        fingerprint.modified != info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch()) {
+        fingerprint = Fingerprint();
+        return false;
+    }
+
+    fingerprint.filePath = info.absoluteFilePath();
+    return true;
+}
+
+void EpisodeMarkers::saveFingerprint(const Fingerprint &fingerprint)
+{
+    const QString path = fingerprintPath(fingerprint.filePath);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream << FINGERPRINT_MAGIC << FINGERPRINT_VERSION << fingerprint.size << fingerprint.modified
+           << fingerprint.durationMs << fingerprint.head << fingerprint.tail;
+    file.commit();
+}
+
+QString EpisodeMarkers::fingerprintPath(const QString &filePath)
+{
+    const QByteArray key = QCryptographicHash::hash(QFileInfo(filePath).absoluteFilePath().toUtf8(),
+                                                    QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/fingerprints/" +
+           QString::fromLatin1(key) + ".fp";
+}
+
+QString EpisodeMarkers::markersPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/episodemarkers.json";
+}
+
+void EpisodeMarkers::loadMarkers()
+{
+    QFile file(markersPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
+        const QJsonObject object = it.value().toObject();
+        Entry entry;
+        entry.size = object.value("size").toInteger(-1);
+        entry.modified = object.value("modified").toInteger(-1);
+        entry.markers.introStart = object.value("introStart").toInteger(-1);
+        entry.markers.introEnd = object.value("introEnd").toInteger(-1);
+        entry.markers.creditsStart = object.value("creditsStart").toInteger(-1);
+        entry.markers.creditsEnd = object.value("creditsEnd").toInteger(-1);
+        m_entries.insert(it.key(), entry);
+    }
+}
+
+void EpisodeMarkers::saveMarkers() const
+{
+    QJsonObject root;
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        QJsonObject object;
+        object.insert("size", it->size);
+        object.insert("modified", it->modified);
+        object.insert("introStart", it->markers.introStart);
+        object.insert("introEnd", it->markers.introEnd);
+        object.insert("creditsStart", it->markers.creditsStart);
+        object.insert("creditsEnd", it->markers.creditsEnd);
+        root.insert(it.key(), object);
+    }
+
+    const QString path = markersPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
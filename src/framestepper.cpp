@@ -0,0 +1,257 @@
+#include "framestepper.h"
+#include <QVideoFrameFormat>
+#include <cmath>
+
+FrameStepper::FrameStepper(QObject *parent)
+    : QObject(parent), m_active(false), m_memoryLimit(256), m_bytes(0), m_hardwareFrames(0), m_cursor(-1),
+    m_injecting(false)
+{
+}
+
+void FrameStepper::setActive(bool active)
+{
+    if (m_active == active) {
+        return;
+    }
+
+    m_active = active;
+
+    if (m_active) {
+        connectSink();
+    } else {
+        disconnectSink();
+        clear();
+    }
+
+    emit activeChanged();
+}
+
+void FrameStepper::setVideoSink(QVideoSink *sink)
+{
+    if (m_videoSink == sink) {
+        return;
+    }
+
+    disconnectSink();
+    clear();
+    m_videoSink = sink;
+    connectSink();
+
+    emit videoSinkChanged();
+}
+
+void FrameStepper::setPlayer(QMediaPlayer *player)
+{
+    if (m_player == player) {
+        return;
+    }
+
+    if (m_player) {
+        disconnect(m_player, nullptr, this, nullptr);
+    }
+
+    m_player = player;
+    clear();
+
+    if (m_player) {
+        connect(m_player, &QMediaPlayer::sourceChanged, this, &FrameStepper::clear);
+        connect(m_player, &QMediaPlayer::playbackStateChanged, this, &FrameStepper::onPlaybackStateChanged);
+    }
+
+    emit playerChanged();
+}
+
+void FrameStepper::setMemoryLimit(int megabytes)
+{
+    megabytes = qMax(0, megabytes);
+    if (m_memoryLimit == megabytes) {
+        return;
+    }
+
+    m_memoryLimit = megabytes;
+    trim();
+
+    emit memoryLimitChanged();
+}
+
+void FrameStepper::stepForward()
+{
+    if (!m_active || !m_player || !m_videoSink) {
+        return;
+    }
+
+    if (m_player->playbackState() == QMediaPlayer::PlayingState) {
+        m_player->pause();
+    }
+
+    if (m_cursor >= 0 && m_cursor + 1 < int(m_frames.size())) {
+        showFrame(m_cursor + 1);
+        return;
+    }
+
+    // Past the newest frame: seek to where it ends, the player decodes exactly one frame further
+    qint64 target = m_player->position() + 1;
+    if (!m_frames.empty() && m_frames.back().endTime() > 0) {
+        target = qint64(std::ceil(m_frames.back().endTime() / 1000.0));
+    }
+    m_cursor = -1;
+    m_player->setPosition(qMin(target, m_player->duration()));
+}
+
+void FrameStepper::stepBackward()
+{
+    if (!m_active || !m_player || !m_videoSink) {
+        return;
+    }
+
+    if (m_player->playbackState() == QMediaPlayer::PlayingState) {
+        m_player->pause();
+    }
+
+    const int current = m_cursor >= 0 ? m_cursor : int(m_frames.size()) - 1;
+    if (current > 0) {
+        showFrame(current - 1);
+        return;
+    }
+
+    // Before the oldest frame: seek into the frame that precedes it
+    qint64 target = m_player->position() - 1;
+    if (!m_frames.empty() && m_frames.front().startTime() >= 0) {
+        target = m_frames.front().startTime() / 1000 - 1;
+    }
+    m_cursor = -1;
+    m_player->setPosition(qMax<qint64>(0, target));
+}
+
+void FrameStepper::connectSink()
+{
+    if (!m_active || !m_videoSink || m_frameConnection) {
+        return;
+    }
+
+    // Queued from the decoder thread, so the ring is only ever touched here
+    m_frameConnection = connect(m_videoSink, &QVideoSink::videoFrameChanged, this, &FrameStepper::onVideoFrame);
+}
+
+void FrameStepper::disconnectSink()
+{
+    if (m_frameConnection) {
+        disconnect(m_frameConnection);
+        m_frameConnection = {};
+    }
+}
+
+void FrameStepper::onVideoFrame(const QVideoFrame &frame)
+{
+    if (m_injecting || !frame.isValid()) {
+        return;
+    }
+
+    if (!m_frames.empty()) {
+        const QVideoFrame &last = m_frames.back();
+        if (frame == last || (frame.startTime() >= 0 && frame.startTime() == last.startTime())) {
+            return;
+        }
+
+        // A seek elsewhere breaks the sequence, older frames would step to the wrong place
+        bool contiguous = frame.startTime() > last.startTime();
+        if (contiguous && last.endTime() > 0) {
+            const qint64 tolerance = qMax<qint64>(1000, (last.endTime() - last.startTime()) / 2);
+            contiguous = std::abs(frame.startTime() - last.endTime()) <= tolerance;
+        }
+        if (!contiguous) {
+            clear();
+        }
+    }
+
+    m_frames.push_back(frame);
+    m_bytes += frameBytes(frame);
+    if (frame.handleType() != QVideoFrame::NoHandle) {
+        ++m_hardwareFrames;
+    }
+    trim();
+}
+
+void FrameStepper::onPlaybackStateChanged(QMediaPlayer::PlaybackState state)
+{
+    if (state != QMediaPlayer::PlayingState || m_cursor < 0) {
+        return;
+    }
+
+    // The player still sits on the newest frame, move it to the one on screen
+    const qint64 start = m_frames[m_cursor].startTime();
+    m_cursor = -1;
+    if (start >= 0) {
+        m_player->setPosition(qint64(std::ceil(start / 1000.0)));
+    }
+}
+
+void FrameStepper::showFrame(int index)
+{
+    m_cursor = index == int(m_frames.size()) - 1 ? -1 : index;
+
+    m_injecting = true;
+    m_videoSink->setVideoFrame(m_frames[index]);
+    m_injecting = false;
+}
+
+void FrameStepper::trim()
+{
+    const qint64 limit = qint64(m_memoryLimit) * 1024 * 1024;
+
+    // Always keep the frame on screen, the oldest ones go first
+    while (m_frames.size() > 1 && (m_bytes > limit || m_hardwareFrames > MAX_HARDWARE_FRAMES)) {
+        if (m_cursor == 0) {
+            break;
+        }
+
+        const QVideoFrame &oldest = m_frames.front();
+        m_bytes -= frameBytes(oldest);
+        if (oldest.handleType() != QVideoFrame::NoHandle) {
+            --m_hardwareFrames;
+        }
+        m_frames.pop_front();
+
+        if (m_cursor > 0) {
+            --m_cursor;
+        }
+    }
+}
+
+void FrameStepper::clear()
+{
+    m_frames.clear();
+    m_bytes = 0;
+    m_hardwareFrames = 0;
+    m_cursor = -1;
+}
+
+qint64 FrameStepper::frameBytes(const QVideoFrame &frame)
+{
+    const qint64 pixels = qint64(frame.width()) * frame.height();
+
+    switch (frame.pixelFormat()) {
+    case QVideoFrameFormat::Format_YUV420P:
+    case QVideoFrameFormat::Format_YV12:
+    case QVideoFrameFormat::Format_NV12:
+    case QVideoFrameFormat::Format_NV21:
+    case QVideoFrameFormat::Format_IMC1:
+    case QVideoFrameFormat::Format_IMC2:
+    case QVideoFrameFormat::Format_IMC3:
+    case QVideoFrameFormat::Format_IMC4:
+        return pixels * 3 / 2;
+    case QVideoFrameFormat::Format_P010:
+    case QVideoFrameFormat::Format_P016:
+    case QVideoFrameFormat::Format_YUV420P10:
+        return pixels * 3;
+    case QVideoFrameFormat::Format_YUV422P:
+    case QVideoFrameFormat::Format_YUYV:
+    case QVideoFrameFormat::Format_UYVY:
+    case QVideoFrameFormat::Format_Y16:
+        return pixels * 2;
+    case QVideoFrameFormat::Format_Y8:
+        return pixels;
+    default:
+        return pixels * 4;
+    }
+}
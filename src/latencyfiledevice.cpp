@@ -0,0 +1,46 @@
+#include "latencyfiledevice.h"
+#include <QThread>
+
+LatencyFileDevice::LatencyFileDevice(const QString &fileName, int latencyMs, qint64 bytesPerSecond, QObject *parent)
+    : QIODevice(parent), m_file(fileName), m_latencyMs(latencyMs), m_bytesPerSecond(bytesPerSecond)
+{
+}
+
+bool LatencyFileDevice::open(OpenMode mode)
+{
+    if ((mode & QIODevice::WriteOnly) || !m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void LatencyFileDevice::close()
+{
+    m_file.close();
+    QIODevice::close();
+}
+
+bool LatencyFileDevice::seek(qint64 pos)
+{
+    return QIODevice::seek(pos) && m_file.seek(pos);
+}
+
+qint64 LatencyFileDevice::readData(char *data, qint64 maxSize)
+{
+    QThread::msleep(m_latencyMs);
+
+    qint64 bytesRead = m_file.read(data, maxSize);
+    if (bytesRead > 0 && m_bytesPerSecond > 0) {
+        QThread::usleep(bytesRead * 1000000 / m_bytesPerSecond);
+    }
+
+    return bytesRead;
+}
+
+qint64 LatencyFileDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
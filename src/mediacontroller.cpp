@@ -1,6 +1,30 @@
 #include "mediacontroller.h"
+#include "readaheaddevice.h"
+#include "latencyfiledevice.h"
+#include "archivereader.h"
+#include "thumbnailprovider.h"
+#include "usersettings.h"
 #include <QCursor>
 #include <QProcess>
+#include <QRandomGenerator>
+#include <QStorageInfo>
+#include <QTimeZone>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+
+namespace {
+
+QStringList mediaNameFilters()
+{
+    return {"*.mp4", "*.avi", "*.mov", "*.mkv", "*.webm", "*.wmv", "*.m4v", "*.flv",
+            "*.mp3", "*.wav", "*.flac", "*.ogg", "*.aac", "*.wma", "*.m4a"};
+}
+
+}
 
 MediaController* MediaController::s_instance = nullptr;
 CoverArtImageProvider* MediaController::s_coverArtProvider = nullptr;
@@ -64,6 +88,12 @@ MediaController::MediaController(QObject *parent)
             this, &MediaController::onMetadataChanged);
     connect(m_metadataPlayer, &QMediaPlayer::mediaStatusChanged,
             this, &MediaController::onMediaStatusChanged);
+    connect(&m_episodeMarkers, &EpisodeMarkers::markersChanged,
+            this, &MediaController::updateMarkers);
+    connect(&m_durationProber, &DurationProber::durationsChanged,
+            this, &MediaController::updatePlaylistDuration);
+    connect(&m_rescanWatcher, &QFutureWatcherBase::finished,
+            this, &MediaController::onRescanFinished);
 
     QStringList args = QGuiApplication::arguments();
 
@@ -83,6 +113,7 @@ MediaController::MediaController(QObject *parent)
 
 MediaController::~MediaController()
 {
+    m_rescanWatcher.waitForFinished();
     setPreventSleep(false);
 }
 
@@ -97,6 +128,9 @@ MediaController* MediaController::create(QQmlEngine *qmlEngine, QJSEngine *jsEng
         if (qmlEngine && s_coverArtProvider) {
             qmlEngine->addImageProvider("coverart", s_coverArtProvider);
         }
+        if (qmlEngine) {
+            qmlEngine->addImageProvider("thumbnails", new ThumbnailProvider());
+        }
     }
     return s_instance;
 }
@@ -117,14 +151,13 @@ void MediaController::loadMediaMetadata(const QString &filePath)
     m_currentAlbum.clear();
     m_currentCoverArtUrl.clear();
 
-    m_metadataPlayer->setSource(QUrl(filePath));
+    setPlayerSource(m_metadataPlayer, filePath, false);
 
-    QSettings settings("Odizinne", "MediaPlayer");
-    QString audioLanguage = settings.value("preferredAudioLanguage", "en").toString();
-    QString subtitleLanguage = settings.value("preferredSubtitleLanguage", "en").toString();
-    bool autoSelectSubtitles = settings.value("autoSelectSubtitles", true).toBool();
+    UserSettings *settings = UserSettings::instance();
+    settings->setCurrentFile(filePath);
+    const UserSettings::FolderProfile profile = settings->resolvedProfile();
 
-    emit trackSelectionRequested(audioLanguage, subtitleLanguage, autoSelectSubtitles);
+    emit folderVolumeRequested(profile.volume);
 }
 
 void MediaController::onMediaStatusChanged(QMediaPlayer::MediaStatus status)
@@ -204,6 +237,12 @@ qint64 MediaController::getFileSize(const QString &filePath)
 {
     QString localPath = filePath;
     if (localPath.startsWith("file://")) {
+        QString archivePath;
+        QString memberName;
+        if (ArchiveIndex::splitMemberUrl(QUrl(localPath), archivePath, memberName)) {
+            ArchiveMember member;
+            return ArchiveIndex::findMember(archivePath, memberName, member) ? member.size : 0;
+        }
         localPath = QUrl(localPath).toLocalFile();
     }
 
@@ -235,84 +274,179 @@ void MediaController::copyPathToClipboard(const QString &filePath)
 
 void MediaController::buildPlaylistFromFile(const QString &filePath)
 {
-    m_playlist.clear();
-    m_currentIndex = -1;
-
     QString localPath = filePath;
     if (localPath.startsWith("file://")) {
         localPath = QUrl(localPath).toLocalFile();
     }
+    bool isArchive = ArchiveIndex::isArchive(localPath);
 
     QFileInfo fileInfo(localPath);
     if (!fileInfo.exists() || !fileInfo.isFile()) {
         qDebug() << "File doesn't exist or is not a file";
+        m_playlist.clear();
+        m_playlistDirectory.clear();
+        m_shuffleOrder.clear();
+        setCurrentIndex(-1);
         emit playlistChanged();
         return;
     }
 
+    // An archive stands in for a folder, its media members make up the playlist
     QDir directory = fileInfo.dir();
-    m_playlist = getSupportedMediaFiles(directory);
-    QString currentAbsolutePath = fileInfo.absoluteFilePath();
+    QString directoryPath = isArchive ? fileInfo.absoluteFilePath() : directory.absolutePath();
+    QString currentKey = playlistKey(filePath);
+
+    // Moving within the current playlist, as every advance does, keeps it and only
+    // rescans the folder in the background, listing and sorting stay off the GUI thread
+    if (directoryPath == m_playlistDirectory) {
+        for (int i = 0; i < m_playlist.size(); ++i) {
+            if (playlistKey(m_playlist[i]) == currentKey) {
+                setCurrentIndex(i);
+                emit playlistChanged();
+                m_quickOpenIndex.markPlayed(m_playlist[i]);
+                rescanPlaylist();
+                return;
+            }
+        }
+    }
 
-    for (int i = 0; i < m_playlist.size(); ++i) {
-        QString playlistAbsolutePath = QFileInfo(m_playlist[i]).absoluteFilePath();
+    QStringList playlist = isArchive ? getArchiveMediaMembers(fileInfo.absoluteFilePath())
+                                     : getSupportedMediaFiles(directory);
+    applyPlaylist(playlist, directoryPath, isArchive, currentKey);
+}
+
+void MediaController::applyPlaylist(const QStringList &playlist, const QString &directoryPath, bool isArchive,
+                                    const QString &currentKey)
+{
+    // Rescanning the same folder keeps the shuffle cycle as long as entries were only appended
+    bool keepOrder = m_shuffleOrder.isValid() && directoryPath == m_playlistDirectory &&
+                     playlist.size() >= m_playlist.size() &&
+                     std::equal(m_playlist.cbegin(), m_playlist.cend(), playlist.cbegin());
+
+    m_playlist = playlist;
+    m_playlistDirectory = directoryPath;
 
-        if (playlistAbsolutePath == currentAbsolutePath) {
-            m_currentIndex = i;
+    int index = -1;
+    for (int i = 0; i < m_playlist.size(); ++i) {
+        if (playlistKey(m_playlist[i]) == currentKey) {
+            index = i;
             break;
         }
     }
 
-    if (m_currentIndex == -1) {
+    if (isArchive && index == -1 && !m_playlist.isEmpty()) {
+        index = 0;
+    } else if (index == -1) {
         qDebug() << "WARNING: Current file not found in playlist!";
     }
 
+    if (keepOrder) {
+        m_shuffleOrder.grow(m_playlist.size());
+    } else {
+        m_currentIndex = index;
+        resetShuffleOrder();
+    }
+
+    setCurrentIndex(index);
     emit playlistChanged();
+
+    m_durationProber.probe(m_playlist);
+
+    // Every folder played from becomes searchable from quick open
+    m_quickOpenIndex.addFiles(m_playlist);
+    if (index >= 0) {
+        m_quickOpenIndex.markPlayed(m_playlist[index]);
+    }
+    if (!isArchive) {
+        analyzeEpisodes();
+    }
+}
+
+void MediaController::rescanPlaylist()
+{
+    if (m_rescanWatcher.isRunning()) {
+        m_rescanQueued = true;
+        return;
+    }
+
+    const QString directoryPath = m_playlistDirectory;
+    const bool isArchive = QFileInfo(directoryPath).isFile();
+    const PlaylistSorter::Order order = static_cast<PlaylistSorter::Order>(m_sortOrder);
+    m_rescanDirectory = directoryPath;
+
+    // Only this task touches the sorter until it finishes, see waitForRescan
+    m_rescanWatcher.setFuture(QtConcurrent::run([this, directoryPath, isArchive, order]() {
+        return isArchive ? m_playlistSorter.sortedArchiveMembers(directoryPath, archiveMediaMembers(directoryPath), order)
+                         : m_playlistSorter.sortedMediaFiles(QDir(directoryPath), mediaNameFilters(), order);
+    }));
+}
+
+void MediaController::onRescanFinished()
+{
+    const QStringList playlist = m_rescanWatcher.result();
+    const QString directoryPath = m_rescanDirectory;
+    m_rescanDirectory.clear();
+
+    // A newer request supersedes this listing, it may have been sorted in the old order
+    if (m_rescanQueued) {
+        m_rescanQueued = false;
+        rescanPlaylist();
+        return;
+    }
+
+    if (directoryPath.isEmpty() || directoryPath != m_playlistDirectory || playlist == m_playlist) {
+        return;
+    }
+
+    const QString currentKey = m_currentIndex >= 0 && m_currentIndex < m_playlist.size()
+                                   ? playlistKey(m_playlist[m_currentIndex]) : QString();
+    applyPlaylist(playlist, directoryPath, QFileInfo(directoryPath).isFile(), currentKey);
+}
+
+void MediaController::waitForRescan()
+{
+    // The sorter is not shared with a background rescan, and a synchronous listing makes its result stale
+    m_rescanWatcher.waitForFinished();
+    m_rescanDirectory.clear();
+    m_rescanQueued = false;
 }
 
 QString MediaController::getNextFile() const
 {
-    if (m_playlist.isEmpty() || m_currentIndex < 0 || m_currentIndex >= m_playlist.size() - 1) {
+    if (m_nextIndex < 0 || m_nextIndex >= m_playlist.size()) {
         return QString();
     }
 
-    return QUrl::fromLocalFile(m_playlist[m_currentIndex + 1]).toString();
+    return entryUrl(m_playlist[m_nextIndex]);
 }
 
 QString MediaController::getPreviousFile() const
 {
-    if (m_playlist.isEmpty() || m_currentIndex <= 0) {
+    if (m_previousIndex < 0 || m_previousIndex >= m_playlist.size()) {
         return QString();
     }
 
-    return QUrl::fromLocalFile(m_playlist[m_currentIndex - 1]).toString();
+    return entryUrl(m_playlist[m_previousIndex]);
 }
 
 bool MediaController::hasNext() const
 {
-    return !m_playlist.isEmpty() && m_currentIndex >= 0 && m_currentIndex < m_playlist.size() - 1;
+    return m_nextIndex >= 0;
 }
 
 bool MediaController::hasPrevious() const
 {
-    return !m_playlist.isEmpty() && m_currentIndex > 0;
+    return m_previousIndex >= 0;
 }
 
 void MediaController::setCurrentFile(const QString &filePath)
 {
-    QString localPath = filePath;
-    if (localPath.startsWith("file://")) {
-        localPath = QUrl(localPath).toLocalFile();
-    }
-
-    QFileInfo fileInfo(localPath);
-    QString currentAbsolutePath = fileInfo.absoluteFilePath();
+    QString currentKey = playlistKey(filePath);
 
     for (int i = 0; i < m_playlist.size(); ++i) {
-        QString playlistAbsolutePath = QFileInfo(m_playlist[i]).absoluteFilePath();
-        if (playlistAbsolutePath == currentAbsolutePath) {
+        if (playlistKey(m_playlist[i]) == currentKey) {
             if (m_currentIndex != i) {
-                m_currentIndex = i;
+                setCurrentIndex(i);
                 emit playlistChanged();
             }
             break;
@@ -320,6 +454,203 @@ void MediaController::setCurrentFile(const QString &filePath)
     }
 }
 
+void MediaController::setCurrentIndex(int index)
+{
+    if (m_shuffle && index >= 0) {
+        if (index == m_nextIndex && m_nextShuffleCycle.isValid()) {
+            m_shuffleOrder = m_nextShuffleCycle;
+        } else if (!m_shuffleOrder.isValid()) {
+            m_currentIndex = index;
+            resetShuffleOrder();
+        }
+        m_shuffleOrder.visit(index);
+    }
+
+    m_currentIndex = index;
+    updateNeighbours();
+    updateMarkers();
+    updatePlaylistDuration();
+}
+
+void MediaController::analyzeEpisodes()
+{
+    // Only video folders are worth decoding, albums rarely share an intro.
+    // An empty list cancels whatever is still being decoded.
+    QStringList episodes;
+    for (const QString &entry : std::as_const(m_playlist)) {
+        if (m_detectEpisodeMarkers && isVideoFile(entry)) {
+            episodes.append(entry);
+        }
+    }
+
+    m_episodeMarkers.analyze(episodes);
+}
+
+QVariantList MediaController::searchFiles(const QString &query)
+{
+    QVariantList results;
+    for (const QuickOpenIndex::Result &result : m_quickOpenIndex.search(query, QUICK_OPEN_RESULTS)) {
+        QVariantMap item;
+        item["url"] = entryUrl(result.path);
+        item["name"] = getFileName(result.path);
+        item["location"] = QDir::toNativeSeparators(result.path.startsWith("file://") ? QUrl(result.path).toLocalFile()
+                                                                                      : result.path);
+        results.append(item);
+    }
+    return results;
+}
+
+void MediaController::updatePlaylistDuration()
+{
+    qint64 total = 0;
+    qint64 upcoming = 0;
+    bool complete = true;
+
+    for (const QString &entry : std::as_const(m_playlist)) {
+        const qint64 duration = m_durationProber.duration(entry);
+        if (duration >= 0) {
+            total += duration;
+        } else {
+            complete = false;
+        }
+    }
+
+    // Walk what is left of this cycle, repeat modes would never end
+    if (m_currentIndex >= 0 && m_currentIndex < m_playlist.size()) {
+        int index = m_currentIndex;
+        for (int step = 0; step < m_playlist.size(); ++step) {
+            if (m_shuffle && m_shuffleOrder.isValid()) {
+                index = m_shuffleOrder.next(index);
+            } else {
+                index = index + 1 < m_playlist.size() ? index + 1 : -1;
+            }
+            if (index < 0) {
+                break;
+            }
+            upcoming += qMax<qint64>(0, m_durationProber.duration(m_playlist[index]));
+        }
+    }
+
+    if (total == m_playlistDuration && upcoming == m_upcomingDuration && complete == m_playlistDurationComplete) {
+        return;
+    }
+
+    m_playlistDuration = total;
+    m_upcomingDuration = upcoming;
+    m_playlistDurationComplete = complete;
+    emit playlistDurationChanged();
+}
+
+void MediaController::updateMarkers()
+{
+    // Markers stored while detection was on are not shown once it is turned off
+    EpisodeMarkers::Markers markers;
+    if (m_detectEpisodeMarkers && m_currentIndex >= 0 && m_currentIndex < m_playlist.size()) {
+        markers = m_episodeMarkers.markers(m_playlist[m_currentIndex]);
+    }
+
+    if (markers.introStart == m_currentMarkers.introStart && markers.introEnd == m_currentMarkers.introEnd &&
+        markers.creditsStart == m_currentMarkers.creditsStart && markers.creditsEnd == m_currentMarkers.creditsEnd) {
+        return;
+    }
+
+    m_currentMarkers = markers;
+    emit markersChanged();
+}
+
+void MediaController::resetShuffleOrder()
+{
+    m_nextShuffleCycle.clear();
+
+    if (m_shuffle && m_currentIndex >= 0 && m_currentIndex < m_playlist.size()) {
+        m_shuffleOrder.reset(m_playlist.size(), m_currentIndex, QRandomGenerator::global()->generate64());
+    } else {
+        m_shuffleOrder.clear();
+    }
+}
+
+void MediaController::updateNeighbours()
+{
+    m_nextIndex = -1;
+    m_previousIndex = -1;
+    m_nextShuffleCycle.clear();
+
+    int size = m_playlist.size();
+    if (m_currentIndex < 0 || m_currentIndex >= size) {
+        return;
+    }
+
+    bool wrap = m_repeatMode == RepeatAll;
+
+    if (m_shuffle && m_shuffleOrder.isValid()) {
+        m_nextIndex = m_shuffleOrder.next(m_currentIndex);
+        m_previousIndex = m_shuffleOrder.previous(m_currentIndex);
+
+        // The next cycle starts from the current entry so it is not played twice in a row
+        if (m_nextIndex < 0 && wrap) {
+            m_nextShuffleCycle.reset(size, m_currentIndex, QRandomGenerator::global()->generate64());
+            m_nextIndex = size > 1 ? m_nextShuffleCycle.next(m_currentIndex) : m_currentIndex;
+        }
+        return;
+    }
+
+    if (m_currentIndex + 1 < size) {
+        m_nextIndex = m_currentIndex + 1;
+    } else if (wrap) {
+        m_nextIndex = 0;
+    }
+
+    if (m_currentIndex > 0) {
+        m_previousIndex = m_currentIndex - 1;
+    } else if (wrap) {
+        m_previousIndex = size - 1;
+    }
+}
+
+void MediaController::setShuffle(bool shuffle)
+{
+    if (m_shuffle == shuffle) {
+        return;
+    }
+
+    m_shuffle = shuffle;
+    resetShuffleOrder();
+    updateNeighbours();
+    updatePlaylistDuration();
+
+    emit playbackOrderChanged();
+    emit playlistChanged();
+}
+
+void MediaController::setRepeatMode(RepeatMode mode)
+{
+    if (m_repeatMode == mode) {
+        return;
+    }
+
+    m_repeatMode = mode;
+    updateNeighbours();
+
+    emit playbackOrderChanged();
+    emit playlistChanged();
+}
+
+void MediaController::setSortOrder(SortOrder order)
+{
+    if (m_sortOrder == order) {
+        return;
+    }
+
+    m_sortOrder = order;
+
+    if (m_currentIndex >= 0 && m_currentIndex < m_playlist.size()) {
+        QString currentFile = m_playlist[m_currentIndex];
+        buildPlaylistFromFile(currentFile);
+    }
+
+    emit playbackOrderChanged();
+}
+
 int MediaController::getCurrentIndex() const
 {
     return m_currentIndex;
@@ -330,20 +661,79 @@ int MediaController::getPlaylistSize() const
     return m_playlist.size();
 }
 
-QStringList MediaController::getSupportedMediaFiles(const QDir &directory) const
+QStringList MediaController::getPlaylist() const
 {
-    QStringList nameFilters;
-    nameFilters << "*.mp4" << "*.avi" << "*.mov" << "*.mkv" << "*.webm" << "*.wmv" << "*.m4v" << "*.flv"
-                << "*.mp3" << "*.wav" << "*.flac" << "*.ogg" << "*.aac" << "*.wma" << "*.m4a";
+    QStringList urls;
+    urls.reserve(m_playlist.size());
+    for (const QString &entry : m_playlist) {
+        urls.append(entryUrl(entry));
+    }
+    return urls;
+}
+
+QStringList MediaController::getSupportedMediaFiles(const QDir &directory)
+{
+    waitForRescan();
+    return m_playlistSorter.sortedMediaFiles(directory, mediaNameFilters(), static_cast<PlaylistSorter::Order>(m_sortOrder));
+}
+
+QList<ArchiveMember> MediaController::archiveMediaMembers(const QString &archivePath) const
+{
+    QList<ArchiveMember> mediaMembers;
+    const QList<ArchiveMember> members = ArchiveIndex::members(archivePath);
+    for (const ArchiveMember &member : members) {
+        if (isMediaFile(member.name)) {
+            mediaMembers << member;
+        }
+    }
+    return mediaMembers;
+}
+
+QStringList MediaController::getArchiveMediaMembers(const QString &archivePath)
+{
+    const qint64 modified = QFileInfo(archivePath).lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+    if (archivePath == m_archiveListing.path && modified == m_archiveListing.modified &&
+        m_sortOrder == m_archiveListing.order) {
+        return m_archiveListing.members;
+    }
+
+    waitForRescan();
+    m_archiveListing = {archivePath, modified, m_sortOrder,
+                        m_playlistSorter.sortedArchiveMembers(archivePath, archiveMediaMembers(archivePath),
+                                                              static_cast<PlaylistSorter::Order>(m_sortOrder))};
+    return m_archiveListing.members;
+}
 
-    QStringList files = directory.entryList(nameFilters, QDir::Files, QDir::Name);
-    QStringList absolutePaths;
+QString MediaController::playlistKey(const QString &source) const
+{
+    QUrl url = source.startsWith("file://") ? QUrl(source) : QUrl::fromLocalFile(source);
 
-    for (const QString &file : std::as_const(files)) {
-        absolutePaths << directory.absoluteFilePath(file);
+    QString archivePath;
+    QString memberName;
+    if (ArchiveIndex::splitMemberUrl(url, archivePath, memberName)) {
+        return ArchiveIndex::memberUrl(QFileInfo(archivePath).absoluteFilePath(), memberName).toString();
     }
 
-    return absolutePaths;
+    return QFileInfo(url.toLocalFile()).absoluteFilePath();
+}
+
+QString MediaController::entryUrl(const QString &entry) const
+{
+    // Archive members are already stored as URLs, plain files as local paths
+    return entry.startsWith("file://") ? entry : QUrl::fromLocalFile(entry).toString();
+}
+
+bool MediaController::isVideoFile(const QString &fileName) const
+{
+    QString lowerName = fileName.toLower();
+    QStringList extensions = {".mp4", ".avi", ".mov", ".mkv", ".webm", ".wmv", ".m4v", ".flv"};
+
+    for (const QString &ext : extensions) {
+        if (lowerName.endsWith(ext)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 bool MediaController::isMediaFile(const QString &fileName) const
@@ -374,11 +764,16 @@ void MediaController::setCursorState(CursorState state)
 
 void MediaController::setPreventSleep(bool prevent)
 {
+    // Only Windows is kept awake, elsewhere the state is tracked so the calls stay balanced
     if (prevent && !m_sleepPrevented) {
+#ifdef Q_OS_WIN
         SetThreadExecutionState(ES_CONTINUOUS | ES_DISPLAY_REQUIRED | ES_SYSTEM_REQUIRED);
+#endif
         m_sleepPrevented = true;
     } else if (!prevent && m_sleepPrevented) {
+#ifdef Q_OS_WIN
         SetThreadExecutionState(ES_CONTINUOUS);
+#endif
         m_sleepPrevented = false;
     }
 }
@@ -495,3 +890,183 @@ void MediaController::onFilePathReceivedFromInstance(const QString &filePath)
     emit fileReceivedFromAnotherInstance(filePath);
 }
 
+void MediaController::setReadAheadMode(ReadAheadMode mode)
+{
+    if (m_readAheadMode != mode) {
+        m_readAheadMode = mode;
+        emit readAheadModeChanged();
+    }
+}
+
+void MediaController::setDetectEpisodeMarkers(bool enabled)
+{
+    if (m_detectEpisodeMarkers == enabled) {
+        return;
+    }
+
+    m_detectEpisodeMarkers = enabled;
+    emit detectEpisodeMarkersChanged();
+    updateMarkers();
+
+    if (!m_playlistDirectory.isEmpty() && !ArchiveIndex::isArchive(m_playlistDirectory)) {
+        analyzeEpisodes();
+    }
+}
+
+void MediaController::setPlaybackStats(PlaybackStats *stats)
+{
+    m_playbackStats = stats;
+}
+
+void MediaController::openSource(QMediaPlayer *player, const QString &source)
+{
+    setPlayerSource(player, source, true);
+}
+
+QString MediaController::resolveSource(const QString &source)
+{
+    QString localPath = source;
+    if (localPath.startsWith("file://")) {
+        QUrl url(localPath);
+        if (url.hasFragment()) {
+            return source;
+        }
+        localPath = url.toLocalFile();
+    }
+
+    if (!ArchiveIndex::isArchive(localPath)) {
+        return source;
+    }
+
+    // Opening an archive plays its first media member
+    QStringList members = getArchiveMediaMembers(QFileInfo(localPath).absoluteFilePath());
+    if (members.isEmpty()) {
+        qWarning() << "No playable uncompressed media in archive:" << localPath;
+        return source;
+    }
+
+    return members.first();
+}
+
+void MediaController::setPlayerSource(QMediaPlayer *player, const QString &source, bool allowReadAhead)
+{
+    if (!player) {
+        return;
+    }
+
+    QUrl url(source);
+    QIODevice *device = createSourceDevice(url, allowReadAhead);
+
+    if (device) {
+        player->setSourceDevice(device, url);
+    } else {
+        player->setSource(url);
+    }
+
+    // The player has let go of the previous device once its source changed
+    QPointer<QIODevice> previous = m_sourceDevices.value(player);
+    if (previous) {
+        previous->deleteLater();
+    }
+
+    if (device) {
+        m_sourceDevices.insert(player, device);
+    } else {
+        m_sourceDevices.remove(player);
+    }
+}
+
+QIODevice* MediaController::createSourceDevice(const QUrl &url, bool allowReadAhead)
+{
+    QString archivePath;
+    QString memberName;
+
+    if (ArchiveIndex::splitMemberUrl(url, archivePath, memberName)) {
+        ArchiveMember member;
+        if (!ArchiveIndex::findMember(archivePath, memberName, member)) {
+            qWarning() << "Archive member not found:" << memberName << "in" << archivePath;
+            return nullptr;
+        }
+
+        QIODevice *device = new ArchiveMemberDevice(archivePath, member, this);
+        if (!device->open(QIODevice::ReadOnly)) {
+            qWarning() << "Could not open archive member:" << memberName;
+            delete device;
+            return nullptr;
+        }
+
+        if (allowReadAhead && shouldReadAhead(archivePath)) {
+            return createReadAheadDevice(device);
+        }
+        return device;
+    }
+
+    if (!allowReadAhead || !url.isLocalFile() || !shouldReadAhead(url.toLocalFile())) {
+        return nullptr;
+    }
+
+    // Lets the read-ahead path be exercised against a local disk
+    QString localPath = url.toLocalFile();
+    int latencyMs = qEnvironmentVariableIntValue("MEDIAPLAYER_SIMULATED_IO_LATENCY_MS");
+
+    QIODevice *upstream = nullptr;
+    if (latencyMs > 0) {
+        upstream = new LatencyFileDevice(localPath, latencyMs);
+    } else {
+        upstream = new QFile(localPath);
+    }
+
+    if (!upstream->open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open for read-ahead:" << localPath;
+        delete upstream;
+        return nullptr;
+    }
+
+    return createReadAheadDevice(upstream);
+}
+
+bool MediaController::shouldReadAhead(const QString &localPath) const
+{
+    if (qEnvironmentVariableIntValue("MEDIAPLAYER_SIMULATED_IO_LATENCY_MS") > 0) {
+        return true;
+    }
+
+    switch (m_readAheadMode) {
+    case ReadAheadAlways:
+        return true;
+    case ReadAheadOff:
+        return false;
+    case ReadAheadNetwork:
+        break;
+    }
+
+#ifdef Q_OS_WIN
+    QString nativePath = QDir::toNativeSeparators(QFileInfo(localPath).absoluteFilePath());
+    if (nativePath.startsWith("\\\\")) {
+        return true;
+    }
+
+    QString root = nativePath.left(3);
+    return GetDriveTypeW(reinterpret_cast<LPCWSTR>(root.utf16())) == DRIVE_REMOTE;
+#else
+    // Mounted shares, told apart by their file system
+    const QByteArray type = QStorageInfo(localPath).fileSystemType();
+    return type.startsWith("nfs") || type.startsWith("cifs") || type.startsWith("smb") || type == "fuse.sshfs";
+#endif
+}
+
+QIODevice* MediaController::createReadAheadDevice(QIODevice *upstream)
+{
+    ReadAheadDevice *device = new ReadAheadDevice(upstream, this);
+    if (!device->open(QIODevice::ReadOnly)) {
+        delete device;
+        return nullptr;
+    }
+
+    if (m_playbackStats) {
+        connect(device, &ReadAheadDevice::bytesFetched, m_playbackStats, &PlaybackStats::recordBytesRead);
+        connect(device, &ReadAheadDevice::stalled, m_playbackStats, &PlaybackStats::recordStall);
+    }
+
+    return device;
+}
@@ -0,0 +1,344 @@
+#include "mediaexporter.h"
+#include "archivereader.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QVideoFrame>
+#include <QtConcurrent/QtConcurrentRun>
+
+MediaExporter::MediaExporter(QObject *parent)
+    : QObject(parent), m_clipStart(-1), m_clipEnd(-1), m_busy(false), m_progress(0), m_clipLength(0),
+    m_cancelled(false)
+{
+    // One frame at a time, below the decoder and render threads
+    m_pool.setMaxThreadCount(1);
+    m_pool.setThreadPriority(QThread::LowPriority);
+
+    connect(&m_snapshotWatcher, &QFutureWatcherBase::finished, this, &MediaExporter::onSnapshotDone);
+
+    m_process.setProcessChannelMode(QProcess::SeparateChannels);
+    connect(&m_process, &QProcess::readyReadStandardOutput, this, &MediaExporter::onProcessOutput);
+    connect(&m_process, &QProcess::finished, this, &MediaExporter::onProcessFinished);
+    connect(&m_process, &QProcess::errorOccurred, this, &MediaExporter::onProcessError);
+}
+
+MediaExporter::~MediaExporter()
+{
+    disconnect(&m_process, nullptr, this, nullptr);
+    if (m_process.state() != QProcess::NotRunning) {
+        m_process.kill();
+        m_process.waitForFinished(1000);
+    }
+    m_snapshotWatcher.waitForFinished();
+}
+
+void MediaExporter::setVideoSink(QVideoSink *sink)
+{
+    if (m_videoSink == sink) {
+        return;
+    }
+
+    m_videoSink = sink;
+    emit videoSinkChanged();
+}
+
+void MediaExporter::setPlayer(QMediaPlayer *player)
+{
+    if (m_player == player) {
+        return;
+    }
+
+    if (m_player) {
+        disconnect(m_player, nullptr, this, nullptr);
+    }
+
+    m_player = player;
+    clearClip();
+
+    if (m_player) {
+        connect(m_player, &QMediaPlayer::sourceChanged, this, &MediaExporter::clearClip);
+    }
+
+    emit playerChanged();
+}
+
+bool MediaExporter::canExportClip() const
+{
+    return m_clipStart >= 0 && m_clipEnd > m_clipStart;
+}
+
+void MediaExporter::saveSnapshot(const QString &format)
+{
+    if (m_busy || !m_videoSink || !m_player) {
+        return;
+    }
+
+    // Only a reference to the decoded frame is taken here, no pixels are touched on the GUI thread
+    const QVideoFrame frame = m_videoSink->videoFrame();
+    if (!frame.isValid()) {
+        emit exportFinished(QString(), tr("No frame to save"));
+        return;
+    }
+
+    QString error;
+    const QString source = sourcePath(error);
+    const QString baseName = QFileInfo(source.isEmpty() ? m_player->source().fileName() : source).completeBaseName();
+    const QString suffix = format.compare("jpg", Qt::CaseInsensitive) == 0 ? "jpg" : "png";
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation);
+    m_snapshotPath = outputPath(directory, baseName + ' ' + timeTag(m_player->position()), suffix);
+
+    m_cancelled = false;
+    setProgress(-1);
+    setBusy(true);
+
+    const QString path = m_snapshotPath;
+    m_snapshotWatcher.setFuture(QtConcurrent::run(&m_pool, [frame, path, suffix]() -> QString {
+        const QImage image = frame.toImage();
+        if (image.isNull()) {
+            return tr("Could not read the frame");
+        }
+
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return file.errorString();
+        }
+
+        QImageWriter writer(&file, suffix.toLatin1());
+        if (suffix == "jpg") {
+            writer.setQuality(95);
+        }
+        if (!writer.write(image)) {
+            file.cancelWriting();
+            return writer.errorString();
+        }
+        return file.commit() ? QString() : file.errorString();
+    }));
+}
+
+void MediaExporter::onSnapshotDone()
+{
+    const QString error = m_snapshotWatcher.result();
+    if (m_cancelled) {
+        QFile::remove(m_snapshotPath);
+        finish(QString(), tr("Cancelled"));
+        return;
+    }
+    finish(error.isEmpty() ? m_snapshotPath : QString(), error);
+}
+
+void MediaExporter::markClipStart()
+{
+    if (!m_player) {
+        return;
+    }
+
+    m_clipStart = m_player->position();
+    if (m_clipEnd >= 0 && m_clipEnd <= m_clipStart) {
+        m_clipEnd = -1;
+    }
+    emit clipChanged();
+}
+
+void MediaExporter::markClipEnd()
+{
+    if (!m_player) {
+        return;
+    }
+
+    m_clipEnd = m_player->position();
+    if (m_clipStart < 0 || m_clipStart >= m_clipEnd) {
+        m_clipStart = 0;
+    }
+    emit clipChanged();
+}
+
+void MediaExporter::clearClip()
+{
+    if (m_clipStart < 0 && m_clipEnd < 0) {
+        return;
+    }
+
+    m_clipStart = -1;
+    m_clipEnd = -1;
+    emit clipChanged();
+}
+
+void MediaExporter::exportClip()
+{
+    if (m_busy || !m_player || !canExportClip()) {
+        return;
+    }
+
+    QString error;
+    const QString source = sourcePath(error);
+    if (source.isEmpty()) {
+        emit exportFinished(QString(), error);
+        return;
+    }
+
+    const QString ffmpeg = findFfmpeg();
+    if (ffmpeg.isEmpty()) {
+        emit exportFinished(QString(), tr("Clip export needs ffmpeg next to the player or on the PATH"));
+        return;
+    }
+
+    const QFileInfo info(source);
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::MoviesLocation);
+    m_clipPath = outputPath(directory, info.completeBaseName() + ' ' + timeTag(m_clipStart) + " - " + timeTag(m_clipEnd),
+                            info.suffix());
+    m_clipLength = m_clipEnd - m_clipStart;
+    QDir().mkpath(directory);
+
+    // Input side seeking snaps to the keyframe before A, stream copy keeps every packet as it is
+    QStringList args;
+    args << "-hide_banner" << "-nostdin" << "-nostats" << "-loglevel" << "error"
+         << "-ss" << QString::number(m_clipStart / 1000.0, 'f', 3)
+         << "-i" << QDir::toNativeSeparators(source)
+         << "-t" << QString::number(m_clipLength / 1000.0, 'f', 3)
+         << "-map" << "0:v?" << "-map" << "0:a?"
+         << "-c" << "copy"
+         << "-avoid_negative_ts" << "make_zero"
+         << "-progress" << "pipe:1"
+         << "-y" << QDir::toNativeSeparators(m_clipPath);
+
+    m_cancelled = false;
+    m_processOutput.clear();
+    setProgress(0);
+    setBusy(true);
+    m_process.start(ffmpeg, args);
+}
+
+void MediaExporter::cancel()
+{
+    if (!m_busy) {
+        return;
+    }
+
+    m_cancelled = true;
+    if (m_process.state() != QProcess::NotRunning) {
+        m_process.kill();
+    }
+}
+
+void MediaExporter::onProcessOutput()
+{
+    m_processOutput += m_process.readAllStandardOutput();
+
+    qsizetype lineEnd;
+    while ((lineEnd = m_processOutput.indexOf('\n')) >= 0) {
+        const QByteArray line = m_processOutput.left(lineEnd).trimmed();
+        m_processOutput.remove(0, lineEnd + 1);
+
+        // Reported in microseconds despite the name on older builds, both keys carry the same value
+        if (line.startsWith("out_time_us=") || line.startsWith("out_time_ms=")) {
+            bool ok = false;
+            const qint64 us = line.mid(line.indexOf('=') + 1).toLongLong(&ok);
+            if (ok && us >= 0 && m_clipLength > 0) {
+                setProgress(qBound(0.0, us / 1000.0 / m_clipLength, 1.0));
+            }
+        }
+    }
+}
+
+void MediaExporter::onProcessFinished(int exitCode, QProcess::ExitStatus status)
+{
+    if (m_cancelled || status != QProcess::NormalExit || exitCode != 0) {
+        const QString message = m_cancelled ? tr("Cancelled")
+                                            : QString::fromLocal8Bit(m_process.readAllStandardError()).trimmed();
+        QFile::remove(m_clipPath);
+        finish(QString(), message.isEmpty() ? tr("ffmpeg failed") : message);
+        return;
+    }
+
+    setProgress(1);
+    finish(m_clipPath, QString());
+}
+
+void MediaExporter::onProcessError(QProcess::ProcessError error)
+{
+    // Crashes and kills also end in finished, only a failed start does not
+    if (error == QProcess::FailedToStart) {
+        finish(QString(), m_process.errorString());
+    }
+}
+
+void MediaExporter::setBusy(bool busy)
+{
+    if (m_busy != busy) {
+        m_busy = busy;
+        emit busyChanged();
+    }
+}
+
+void MediaExporter::setProgress(double progress)
+{
+    if (m_progress != progress) {
+        m_progress = progress;
+        emit progressChanged();
+    }
+}
+
+void MediaExporter::finish(const QString &filePath, const QString &error)
+{
+    if (!error.isEmpty()) {
+        qWarning() << "Export failed:" << error;
+    }
+
+    setBusy(false);
+    emit exportFinished(filePath, error);
+}
+
+QString MediaExporter::sourcePath(QString &error) const
+{
+    const QUrl url = m_player ? m_player->source() : QUrl();
+    if (!url.isLocalFile()) {
+        error = tr("Only local files can be exported");
+        return QString();
+    }
+
+    QString archivePath;
+    QString memberName;
+    if (ArchiveIndex::splitMemberUrl(url, archivePath, memberName)) {
+        error = tr("Files inside archives can not be exported");
+        return QString();
+    }
+
+    return url.toLocalFile();
+}
+
+QString MediaExporter::outputPath(const QString &directory, const QString &baseName, const QString &suffix)
+{
+    QString name = baseName;
+    name.replace(QRegularExpression(R"([<>:"/\\|?*])"), "-");
+
+    QString path = directory + '/' + name + '.' + suffix;
+    for (int i = 2; QFileInfo::exists(path); ++i) {
+        path = directory + '/' + name + " (" + QString::number(i) + ")." + suffix;
+    }
+    return path;
+}
+
+QString MediaExporter::timeTag(qint64 ms)
+{
+    const qint64 seconds = ms / 1000;
+    return QString("%1.%2.%3.%4")
+        .arg(seconds / 3600, 2, 10, QChar('0'))
+        .arg(seconds / 60 % 60, 2, 10, QChar('0'))
+        .arg(seconds % 60, 2, 10, QChar('0'))
+        .arg(ms % 1000, 3, 10, QChar('0'));
+}
+
+QString MediaExporter::findFfmpeg()
+{
+    const QString bundled = QStandardPaths::findExecutable("ffmpeg", {QCoreApplication::applicationDirPath()});
+    return bundled.isEmpty() ? QStandardPaths::findExecutable("ffmpeg") : bundled;
+}
@@ -0,0 +1,350 @@
+#include "playbackstats.h"
+#include <QFileInfo>
+#include <QMediaMetaData>
+#include <QUrl>
+#include <QtMath>
+
+namespace {
+
+// Upper bounds of the presentation delay histogram buckets, in microseconds
+const qint64 DELAY_BUCKET_LIMITS_US[] = {1000, 2000, 4000, 8000, 16000, 33000, 66000};
+
+}
+
+PlaybackStats::PlaybackStats(QObject *parent)
+    : QObject(parent), m_active(false), m_writeIndex(0), m_frameCount(0), m_dropped(0), m_late(0),
+    m_delaySumUs(0), m_delaySamples(0), m_frameIntervalUs(0), m_rebase(true), m_playbackRate(1.0),
+    m_lastPts(-1), m_baseArrival(0), m_basePts(0), m_bytesRead(0), m_stallCount(0), m_stallTimeUs(0),
+    m_lastBytesRead(0), m_lastPublish(0), m_effectiveFps(0), m_nominalFps(0), m_jitterMs(0),
+    m_droppedFrames(0), m_lateFrames(0), m_totalFrames(0), m_meanDelayMs(0), m_bitrate(0),
+    m_ioThroughput(0), m_ioStalls(0), m_ioStallMs(0), m_openStarted(-1), m_endOfMedia(-1), m_advanceStarted(-1),
+    m_openLatencyMs(-1), m_advanceLatencyMs(-1)
+{
+    for (auto &arrival : m_arrivals) {
+        arrival.store(0, std::memory_order_relaxed);
+    }
+    for (auto &bucket : m_histogram) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+
+    m_clock.start();
+    m_publishTimer.setInterval(PUBLISH_INTERVAL_MS);
+    connect(&m_publishTimer, &QTimer::timeout, this, &PlaybackStats::publish);
+}
+
+PlaybackStats::~PlaybackStats()
+{
+    disconnectSink();
+}
+
+void PlaybackStats::setActive(bool active)
+{
+    if (m_active == active) {
+        return;
+    }
+
+    m_active = active;
+
+    if (m_active) {
+        reset();
+        connectSink();
+        m_publishTimer.start();
+    } else {
+        disconnectSink();
+        m_publishTimer.stop();
+    }
+
+    emit activeChanged();
+}
+
+void PlaybackStats::setVideoSink(QVideoSink *sink)
+{
+    if (m_videoSink == sink) {
+        return;
+    }
+
+    disconnectSink();
+    m_videoSink = sink;
+    connectSink();
+
+    emit videoSinkChanged();
+}
+
+void PlaybackStats::setPlayer(QMediaPlayer *player)
+{
+    if (m_player == player) {
+        return;
+    }
+
+    if (m_player) {
+        disconnect(m_player, nullptr, this, nullptr);
+    }
+
+    m_player = player;
+
+    if (m_player) {
+        m_playbackRate.store(m_player->playbackRate(), std::memory_order_relaxed);
+        connect(m_player, &QMediaPlayer::playbackStateChanged, this, &PlaybackStats::requestRebase);
+        connect(m_player, &QMediaPlayer::sourceChanged, this, &PlaybackStats::reset);
+        connect(m_player, &QMediaPlayer::sourceChanged, this, &PlaybackStats::onSourceChanged);
+        connect(m_player, &QMediaPlayer::mediaStatusChanged, this, &PlaybackStats::onMediaStatusChanged);
+        connect(m_player, &QMediaPlayer::playbackStateChanged, this, &PlaybackStats::onPlaybackStateChanged);
+        connect(m_player, &QMediaPlayer::playbackRateChanged, this, [this](qreal rate) {
+            m_playbackRate.store(rate, std::memory_order_relaxed);
+            requestRebase();
+        });
+    }
+
+    emit playerChanged();
+}
+
+QVariantList PlaybackStats::delayHistogramLabels() const
+{
+    return {"<1", "1-2", "2-4", "4-8", "8-16", "16-33", "33-66", ">66"};
+}
+
+void PlaybackStats::recordBytesRead(qint64 bytes)
+{
+    m_bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void PlaybackStats::recordStall(qint64 durationUs)
+{
+    m_stallCount.fetch_add(1, std::memory_order_relaxed);
+    m_stallTimeUs.fetch_add(durationUs, std::memory_order_relaxed);
+}
+
+void PlaybackStats::reset()
+{
+    m_writeIndex.store(0, std::memory_order_relaxed);
+    m_frameCount.store(0, std::memory_order_relaxed);
+    m_dropped.store(0, std::memory_order_relaxed);
+    m_late.store(0, std::memory_order_relaxed);
+    m_delaySumUs.store(0, std::memory_order_relaxed);
+    m_delaySamples.store(0, std::memory_order_relaxed);
+    m_frameIntervalUs.store(0, std::memory_order_relaxed);
+    m_stallCount.store(0, std::memory_order_relaxed);
+    m_stallTimeUs.store(0, std::memory_order_relaxed);
+    for (auto &bucket : m_histogram) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_rebase.store(true, std::memory_order_release);
+
+    m_lastBytesRead = m_bytesRead.load(std::memory_order_relaxed);
+    m_lastPublish = m_clock.nsecsElapsed();
+
+    publish();
+}
+
+void PlaybackStats::onSourceChanged(const QUrl &source)
+{
+    // Opening clears the source first, only the real one starts the clock
+    m_openStarted = source.isEmpty() ? -1 : m_clock.nsecsElapsed();
+    m_endOfMedia = -1;
+}
+
+void PlaybackStats::markAutoAdvance()
+{
+    m_advanceStarted = m_endOfMedia >= 0 ? m_endOfMedia : m_clock.nsecsElapsed();
+    m_endOfMedia = -1;
+}
+
+void PlaybackStats::onMediaStatusChanged(QMediaPlayer::MediaStatus status)
+{
+    if (status == QMediaPlayer::LoadedMedia && m_openStarted >= 0) {
+        m_openLatencyMs = (m_clock.nsecsElapsed() - m_openStarted) / 1e6;
+        m_openStarted = -1;
+        emit statsChanged();
+    } else if (status == QMediaPlayer::EndOfMedia) {
+        m_endOfMedia = m_clock.nsecsElapsed();
+    }
+}
+
+void PlaybackStats::onPlaybackStateChanged(QMediaPlayer::PlaybackState state)
+{
+    if (state != QMediaPlayer::PlayingState || m_advanceStarted < 0) {
+        return;
+    }
+
+    m_advanceLatencyMs = (m_clock.nsecsElapsed() - m_advanceStarted) / 1e6;
+    m_advanceStarted = -1;
+    emit statsChanged();
+}
+
+void PlaybackStats::requestRebase()
+{
+    m_rebase.store(true, std::memory_order_release);
+}
+
+void PlaybackStats::connectSink()
+{
+    if (!m_active || !m_videoSink || m_frameConnection) {
+        return;
+    }
+
+    // Direct connection: frames are timed on the thread that delivers them
+    m_frameConnection = connect(m_videoSink, &QVideoSink::videoFrameChanged, this,
+                                [this](const QVideoFrame &frame) { onVideoFrame(frame); },
+                                Qt::DirectConnection);
+}
+
+void PlaybackStats::disconnectSink()
+{
+    if (m_frameConnection) {
+        disconnect(m_frameConnection);
+        m_frameConnection = {};
+    }
+}
+
+void PlaybackStats::onVideoFrame(const QVideoFrame &frame)
+{
+    if (!frame.isValid()) {
+        return;
+    }
+
+    const qint64 arrival = m_clock.nsecsElapsed();
+    const quint32 index = m_writeIndex.load(std::memory_order_relaxed);
+    m_arrivals[index % RING_SIZE].store(arrival, std::memory_order_relaxed);
+    m_writeIndex.store(index + 1, std::memory_order_release);
+    m_frameCount.fetch_add(1, std::memory_order_relaxed);
+
+    const qint64 pts = frame.startTime();
+    if (pts < 0) {
+        return;
+    }
+
+    const double streamFps = frame.streamFrameRate();
+    qint64 interval = streamFps > 0 ? qint64(1000000.0 / streamFps) : m_frameIntervalUs.load(std::memory_order_relaxed);
+
+    const bool rebase = m_rebase.exchange(false, std::memory_order_acq_rel) || m_lastPts < 0 ||
+                        pts <= m_lastPts || pts - m_lastPts > DISCONTINUITY_US;
+
+    if (!rebase) {
+        const qint64 gap = pts - m_lastPts;
+        if (streamFps <= 0 && (interval <= 0 || gap < interval)) {
+            interval = gap;
+        }
+        if (interval > 0 && gap * 2 > interval * 3) {
+            m_dropped.fetch_add(quint32(qRound(double(gap) / interval) - 1), std::memory_order_relaxed);
+        }
+    }
+
+    m_frameIntervalUs.store(interval, std::memory_order_relaxed);
+    m_lastPts = pts;
+
+    if (rebase) {
+        m_baseArrival = arrival;
+        m_basePts = pts;
+        return;
+    }
+
+    // Delay between the frame's place on the presentation timeline and its arrival at the sink
+    const double rate = qMax(0.01, m_playbackRate.load(std::memory_order_relaxed));
+    const qint64 expected = m_baseArrival + qint64((pts - m_basePts) * 1000.0 / rate);
+    qint64 delayUs = (arrival - expected) / 1000;
+    if (delayUs < 0) {
+        m_baseArrival = arrival;
+        m_basePts = pts;
+        delayUs = 0;
+    }
+
+    m_delaySumUs.fetch_add(delayUs, std::memory_order_relaxed);
+    m_delaySamples.fetch_add(1, std::memory_order_relaxed);
+    if (interval > 0 && delayUs > interval) {
+        m_late.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int bucket = 0;
+    while (bucket < HISTOGRAM_BUCKETS - 1 && delayUs >= DELAY_BUCKET_LIMITS_US[bucket]) {
+        ++bucket;
+    }
+    m_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void PlaybackStats::publish()
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    const quint32 written = m_writeIndex.load(std::memory_order_acquire);
+    const quint32 count = qMin<quint32>(written, RING_SIZE);
+
+    int framesInLastSecond = 0;
+    int deltas = 0;
+    double sum = 0;
+    double sumSquares = 0;
+    qint64 newer = -1;
+
+    for (quint32 i = 0; i < count; ++i) {
+        const qint64 arrival = m_arrivals[(written - 1 - i) % RING_SIZE].load(std::memory_order_relaxed);
+        if (now - arrival > JITTER_WINDOW_NS) {
+            break;
+        }
+        if (now - arrival <= 1000000000) {
+            ++framesInLastSecond;
+        }
+        if (newer >= 0) {
+            const double delta = (newer - arrival) / 1e6;
+            sum += delta;
+            sumSquares += delta * delta;
+            ++deltas;
+        }
+        newer = arrival;
+    }
+
+    m_effectiveFps = framesInLastSecond;
+    if (deltas > 1) {
+        const double mean = sum / deltas;
+        m_jitterMs = qSqrt(qMax(0.0, sumSquares / deltas - mean * mean));
+    } else {
+        m_jitterMs = 0;
+    }
+
+    const qint64 interval = m_frameIntervalUs.load(std::memory_order_relaxed);
+    m_nominalFps = interval > 0 ? 1000000.0 / interval : 0;
+    m_totalFrames = int(m_frameCount.load(std::memory_order_relaxed));
+    m_droppedFrames = int(m_dropped.load(std::memory_order_relaxed));
+    m_lateFrames = int(m_late.load(std::memory_order_relaxed));
+
+    const quint32 samples = m_delaySamples.load(std::memory_order_relaxed);
+    m_meanDelayMs = samples > 0 ? m_delaySumUs.load(std::memory_order_relaxed) / 1000.0 / samples : 0;
+
+    m_delayHistogram.clear();
+    for (const auto &bucket : m_histogram) {
+        m_delayHistogram.append(bucket.load(std::memory_order_relaxed));
+    }
+
+    const qint64 bytesRead = m_bytesRead.load(std::memory_order_relaxed);
+    const qint64 elapsed = now - m_lastPublish;
+    if (elapsed > 0) {
+        m_ioThroughput = (bytesRead - m_lastBytesRead) * 1000000000 / elapsed;
+    }
+    m_lastBytesRead = bytesRead;
+    m_lastPublish = now;
+    m_ioStalls = int(m_stallCount.load(std::memory_order_relaxed));
+    m_ioStallMs = m_stallTimeUs.load(std::memory_order_relaxed) / 1000.0;
+
+    m_bitrate = computeBitrate();
+
+    emit statsChanged();
+}
+
+qint64 PlaybackStats::computeBitrate() const
+{
+    if (!m_player) {
+        return 0;
+    }
+
+    const QMediaMetaData metaData = m_player->metaData();
+    const qint64 bitrate = metaData.value(QMediaMetaData::VideoBitRate).toLongLong() +
+                           metaData.value(QMediaMetaData::AudioBitRate).toLongLong();
+    if (bitrate > 0) {
+        return bitrate;
+    }
+
+    const QUrl source = m_player->source();
+    const qint64 duration = m_player->duration();
+    if (!source.isLocalFile() || duration <= 0) {
+        return 0;
+    }
+
+    return QFileInfo(source.toLocalFile()).size() * 8 * 1000 / duration;
+}
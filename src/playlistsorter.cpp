@@ -0,0 +1,429 @@
+#include "playlistsorter.h"
+#include <QCollator>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringDecoder>
+#include <QThread>
+#include <QTimeZone>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtEndian>
+#include <algorithm>
+
+namespace {
+
+int parseTrackNumber(const QString &text)
+{
+    bool ok = false;
+    int track = text.section('/', 0, 0).trimmed().toInt(&ok);
+    return ok && track >= 0 ? track : -1;
+}
+
+QString decodeId3Text(const QByteArray &frame)
+{
+    if (frame.isEmpty()) {
+        return QString();
+    }
+
+    QByteArray payload = frame.mid(1);
+    QString text;
+    switch (frame.at(0)) {
+    case 1: {
+        QStringDecoder decoder(QStringDecoder::Utf16);
+        text = decoder.decode(payload);
+        break;
+    }
+    case 2: {
+        QStringDecoder decoder(QStringDecoder::Utf16BE);
+        text = decoder.decode(payload);
+        break;
+    }
+    case 3:
+        text = QString::fromUtf8(payload);
+        break;
+    default:
+        text = QString::fromLatin1(payload);
+        break;
+    }
+
+    int nul = text.indexOf(QChar(0));
+    return nul >= 0 ? text.left(nul) : text;
+}
+
+quint32 syncSafe(const uchar *data)
+{
+    return (quint32(data[0] & 0x7f) << 21) | (quint32(data[1] & 0x7f) << 14) |
+           (quint32(data[2] & 0x7f) << 7) | quint32(data[3] & 0x7f);
+}
+
+int readId3TrackNumber(QIODevice &file, const QByteArray &header)
+{
+    const uchar *h = reinterpret_cast<const uchar *>(header.constData());
+    const int version = h[3];
+    const qint64 tagEnd = 10 + syncSafe(h + 6);
+    const int frameHeaderSize = version == 2 ? 6 : 10;
+
+    qint64 pos = 10;
+    if ((h[5] & 0x40) && version >= 3) {
+        QByteArray extended = file.seek(pos) ? file.read(4) : QByteArray();
+        if (extended.size() < 4) {
+            return -1;
+        }
+        const uchar *e = reinterpret_cast<const uchar *>(extended.constData());
+        pos += version == 4 ? syncSafe(e) : qFromBigEndian<quint32>(e) + 4;
+    }
+
+    while (pos + frameHeaderSize <= tagEnd && file.seek(pos)) {
+        QByteArray frameHeader = file.read(frameHeaderSize);
+        if (frameHeader.size() < frameHeaderSize || frameHeader.at(0) == 0) {
+            break;
+        }
+
+        const uchar *f = reinterpret_cast<const uchar *>(frameHeader.constData());
+        QByteArray id;
+        quint32 size;
+        if (version == 2) {
+            id = frameHeader.left(3);
+            size = (quint32(f[3]) << 16) | (quint32(f[4]) << 8) | f[5];
+        } else {
+            id = frameHeader.left(4);
+            size = version == 4 ? syncSafe(f + 4) : qFromBigEndian<quint32>(f + 4);
+        }
+
+        if (id == "TRCK" || id == "TRK") {
+            return parseTrackNumber(decodeId3Text(file.read(qMin<quint32>(size, 64))));
+        }
+
+        pos += frameHeaderSize + size;
+    }
+
+    return -1;
+}
+
+int readFlacTrackNumber(QIODevice &file)
+{
+    qint64 pos = 4;
+    bool last = false;
+
+    while (!last && file.seek(pos)) {
+        QByteArray blockHeader = file.read(4);
+        if (blockHeader.size() < 4) {
+            break;
+        }
+
+        const uchar *b = reinterpret_cast<const uchar *>(blockHeader.constData());
+        last = b[0] & 0x80;
+        const int type = b[0] & 0x7f;
+        const quint32 length = (quint32(b[1]) << 16) | (quint32(b[2]) << 8) | b[3];
+
+        if (type == 4) {
+            QByteArray block = file.read(length);
+            const uchar *data = reinterpret_cast<const uchar *>(block.constData());
+            qsizetype offset = 0;
+
+            auto readLength = [&](quint32 &value) {
+                if (offset + 4 > block.size()) {
+                    return false;
+                }
+                value = qFromLittleEndian<quint32>(data + offset);
+                offset += 4;
+                return true;
+            };
+
+            quint32 vendorLength = 0;
+            quint32 count = 0;
+            if (!readLength(vendorLength)) {
+                break;
+            }
+            offset += vendorLength;
+            if (!readLength(count)) {
+                break;
+            }
+
+            for (quint32 i = 0; i < count; ++i) {
+                quint32 commentLength = 0;
+                if (!readLength(commentLength) || offset + qsizetype(commentLength) > block.size()) {
+                    break;
+                }
+                QByteArray comment = block.mid(offset, commentLength);
+                offset += commentLength;
+                if (comment.size() > 12 && comment.left(12).toUpper() == "TRACKNUMBER=") {
+                    return parseTrackNumber(QString::fromUtf8(comment.mid(12)));
+                }
+            }
+            break;
+        }
+
+        pos += 4 + length;
+    }
+
+    return -1;
+}
+
+// Returns the payload range of the first child box of the given type within [begin, end)
+bool findMp4Box(QIODevice &file, qint64 begin, qint64 end, const char *type, qint64 &payloadBegin, qint64 &payloadEnd)
+{
+    qint64 pos = begin;
+    while (pos + 8 <= end && file.seek(pos)) {
+        QByteArray header = file.read(8);
+        if (header.size() < 8) {
+            return false;
+        }
+
+        quint64 size = qFromBigEndian<quint32>(header.constData());
+        qint64 headerSize = 8;
+        if (size == 1) {
+            QByteArray largeSize = file.read(8);
+            if (largeSize.size() < 8) {
+                return false;
+            }
+            size = qFromBigEndian<quint64>(largeSize.constData());
+            headerSize = 16;
+        } else if (size == 0) {
+            size = end - pos;
+        }
+
+        if (size < quint64(headerSize) || size > quint64(end - pos)) {
+            return false;
+        }
+
+        if (header.mid(4, 4) == type) {
+            payloadBegin = pos + headerSize;
+            payloadEnd = pos + qint64(size);
+            return true;
+        }
+
+        pos += qint64(size);
+    }
+
+    return false;
+}
+
+int readMp4TrackNumber(QIODevice &file)
+{
+    qint64 begin = 0;
+    qint64 end = file.size();
+
+    for (const char *type : {"moov", "udta", "meta", "ilst", "trkn", "data"}) {
+        if (!findMp4Box(file, begin, end, type, begin, end)) {
+            return -1;
+        }
+        // meta is a full box, its children start after version and flags
+        if (qstrcmp(type, "meta") == 0) {
+            begin += 4;
+        }
+    }
+
+    // data payload: type indicator, locale, then reserved(2) track(2) total(2)
+    if (!file.seek(begin) || end - begin < 12) {
+        return -1;
+    }
+    QByteArray data = file.read(12);
+    return data.size() == 12 ? qFromBigEndian<quint16>(data.constData() + 10) : -1;
+}
+
+int readTrackNumber(QIODevice &file)
+{
+    QByteArray header = file.read(12);
+    if (header.startsWith("ID3") && header.size() >= 10) {
+        return readId3TrackNumber(file, header);
+    }
+    if (header.startsWith("fLaC")) {
+        return readFlacTrackNumber(file);
+    }
+    if (header.mid(4, 4) == "ftyp") {
+        return readMp4TrackNumber(file);
+    }
+
+    return -1;
+}
+
+int readTrackNumber(const QString &filePath)
+{
+    QFile file(filePath);
+    return file.open(QIODevice::ReadOnly) ? readTrackNumber(file) : -1;
+}
+
+int readMemberTrackNumber(const QString &archivePath, const ArchiveMember &member)
+{
+    ArchiveMemberDevice device(archivePath, member);
+    return device.open(QIODevice::ReadOnly) ? readTrackNumber(device) : -1;
+}
+
+}
+
+QStringList PlaylistSorter::sortedMediaFiles(const QDir &directory, const QStringList &nameFilters, Order order)
+{
+    const QString directoryPath = directory.absolutePath();
+    useContainer(directoryPath);
+
+    const QFileInfoList infos = directory.entryInfoList(nameFilters, QDir::Files, QDir::NoSort);
+
+    std::vector<Entry> entries;
+    entries.reserve(infos.size());
+    for (const QFileInfo &info : infos) {
+        entries.push_back(cachedEntry(info.fileName(), info.size(),
+                                      info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch()));
+    }
+
+    const std::vector<const Entry *> sorted = sortEntries(entries, order);
+
+    QStringList paths;
+    paths.reserve(sorted.size());
+    for (const Entry *entry : sorted) {
+        paths << directoryPath + '/' + entry->fileName;
+    }
+
+    storeEntries(entries);
+    return paths;
+}
+
+QStringList PlaylistSorter::sortedArchiveMembers(const QString &archivePath, const QList<ArchiveMember> &members,
+                                                 Order order)
+{
+    useContainer(archivePath);
+
+    // Any change to the archive invalidates the keys of all its members
+    const qint64 modified = QFileInfo(archivePath).lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+
+    std::vector<Entry> entries;
+    entries.reserve(members.size());
+    for (const ArchiveMember &member : members) {
+        entries.push_back(cachedEntry(member.name, member.size, modified));
+        entries.back().offset = member.offset;
+    }
+
+    const std::vector<const Entry *> sorted = sortEntries(entries, order);
+
+    QStringList urls;
+    urls.reserve(sorted.size());
+    for (const Entry *entry : sorted) {
+        urls << ArchiveIndex::memberUrl(archivePath, entry->fileName).toString();
+    }
+
+    storeEntries(entries);
+    return urls;
+}
+
+void PlaylistSorter::useContainer(const QString &path)
+{
+    if (path != m_directory) {
+        m_cache.clear();
+        m_directory = path;
+    }
+}
+
+PlaylistSorter::Entry PlaylistSorter::cachedEntry(const QString &fileName, qint64 size, qint64 modified) const
+{
+    auto cached = m_cache.constFind(fileName);
+    if (cached != m_cache.cend() && cached->size == size && cached->modified == modified) {
+        return *cached;
+    }
+
+    Entry entry;
+    entry.fileName = fileName;
+    entry.size = size;
+    entry.modified = modified;
+    return entry;
+}
+
+std::vector<const PlaylistSorter::Entry *> PlaylistSorter::sortEntries(std::vector<Entry> &entries, Order order)
+{
+    const bool readTrackNumbers = order == ByTrackNumber;
+    std::vector<Entry *> pending;
+    for (Entry &entry : entries) {
+        if (!entry.nameKey || (readTrackNumbers && !entry.trackNumberRead)) {
+            pending.push_back(&entry);
+        }
+    }
+    computeKeys(pending, readTrackNumbers);
+
+    std::vector<const Entry *> sorted;
+    sorted.reserve(entries.size());
+    for (const Entry &entry : entries) {
+        sorted.push_back(&entry);
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [order](const Entry *a, const Entry *b) {
+        switch (order) {
+        case ByModified:
+            if (a->modified != b->modified) {
+                return a->modified < b->modified;
+            }
+            break;
+        case BySize:
+            if (a->size != b->size) {
+                return a->size < b->size;
+            }
+            break;
+        case ByTrackNumber:
+            // Files without a track number go after numbered ones
+            if (a->trackNumber != b->trackNumber) {
+                if (a->trackNumber < 0 || b->trackNumber < 0) {
+                    return b->trackNumber < 0;
+                }
+                return a->trackNumber < b->trackNumber;
+            }
+            break;
+        case ByName:
+            break;
+        }
+
+        int result = a->nameKey->compare(*b->nameKey);
+        return result != 0 ? result < 0 : a->fileName < b->fileName;
+    });
+
+    return sorted;
+}
+
+void PlaylistSorter::storeEntries(std::vector<Entry> &entries)
+{
+    QHash<QString, Entry> cache;
+    cache.reserve(entries.size());
+    for (Entry &entry : entries) {
+        QString fileName = entry.fileName;
+        cache.insert(fileName, std::move(entry));
+    }
+    m_cache = std::move(cache);
+}
+
+void PlaylistSorter::computeKeys(const std::vector<Entry *> &pending, bool readTrackNumbers)
+{
+    if (pending.empty()) {
+        return;
+    }
+
+    const qsizetype total = qsizetype(pending.size());
+    const qsizetype chunkCount = total < PARALLEL_THRESHOLD ? 1 : qMax(1, QThread::idealThreadCount());
+    const qsizetype chunkSize = (total + chunkCount - 1) / chunkCount;
+
+    QList<QPair<qsizetype, qsizetype>> chunks;
+    for (qsizetype begin = 0; begin < total; begin += chunkSize) {
+        chunks.append(qMakePair(begin, qMin(begin + chunkSize, total)));
+    }
+
+    auto computeChunk = [&](const QPair<qsizetype, qsizetype> &chunk) {
+        // QCollator is not safe to share between threads, each chunk gets its own
+        QCollator collator;
+        collator.setNumericMode(true);
+        collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+        for (qsizetype i = chunk.first; i < chunk.second; ++i) {
+            Entry *entry = pending[i];
+            if (!entry->nameKey) {
+                entry->nameKey = collator.sortKey(entry->fileName);
+            }
+            if (readTrackNumbers && !entry->trackNumberRead) {
+                entry->trackNumber = entry->offset >= 0
+                                         ? readMemberTrackNumber(m_directory, {entry->fileName, entry->offset, entry->size})
+                                         : readTrackNumber(m_directory + '/' + entry->fileName);
+                entry->trackNumberRead = true;
+            }
+        }
+    };
+
+    if (chunks.size() == 1) {
+        computeChunk(chunks.first());
+    } else {
+        QtConcurrent::blockingMap(chunks, computeChunk);
+    }
+}
@@ -0,0 +1,726 @@
+#include "quickopenindex.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// A candidate has to contain this share of the query's trigrams, which leaves room for typos
+const double MIN_TRIGRAM_SHARE = 0.6;
+
+template <typename T>
+void writeArray(QIODevice &device, const T *data, qsizetype count)
+{
+    device.write(reinterpret_cast<const char *>(data), qint64(count * sizeof(T)));
+}
+
+double recencyScore(quint32 played, qint64 now)
+{
+    if (played == 0) {
+        return 0;
+    }
+    const double days = double(qMax<qint64>(0, now - played)) / 86400.0;
+    return 0.5 / (1.0 + days / 7.0);
+}
+
+}
+
+bool QuickOpenIndex::Postings::contains(quint32 id, quint32 baseCount) const
+{
+    if (id < baseCount) {
+        return std::binary_search(base, base + baseSize, id);
+    }
+    return added && std::binary_search(added->cbegin(), added->cend(), id);
+}
+
+QuickOpenIndex::QuickOpenIndex(QObject *parent)
+    : QObject(parent), m_map(nullptr), m_validatePending(false), m_savePending(false), m_dirty(false)
+{
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &QuickOpenIndex::save);
+    connect(&m_saveWatcher, &QFutureWatcherBase::finished, this, &QuickOpenIndex::onSaved);
+    connect(&m_validateWatcher, &QFutureWatcherBase::finished, this, &QuickOpenIndex::onValidated);
+
+    mapBase(true);
+}
+
+QuickOpenIndex::~QuickOpenIndex()
+{
+    m_validateWatcher.waitForFinished();
+    if (m_validatePending) {
+        onValidated();
+    }
+
+    m_saveTimer.stop();
+    m_saveWatcher.waitForFinished();
+    if (m_savePending) {
+        onSaved();
+    }
+
+    if (m_dirty) {
+        const Snapshot snapshot{m_base, m_addedPaths, m_addedPlayed, m_addedPostings, m_playedOverrides};
+        if (writeIndex(indexPath() + ".new", snapshot)) {
+            replaceBase();
+        }
+    }
+}
+
+void QuickOpenIndex::addFiles(const QStringList &paths)
+{
+    bool added = false;
+    for (const QString &path : paths) {
+        if (findId(path) < 0) {
+            add(path);
+            added = true;
+        }
+    }
+
+    if (added) {
+        scheduleSave();
+    }
+}
+
+void QuickOpenIndex::markPlayed(const QString &path)
+{
+    qint64 id = findId(path);
+    if (id < 0) {
+        id = add(path);
+    }
+
+    const quint32 now = quint32(QDateTime::currentSecsSinceEpoch());
+    if (quint32(id) < m_base.pathCount) {
+        m_playedOverrides.insert(quint32(id), now);
+    } else {
+        m_addedPlayed[id - m_base.pathCount] = now;
+    }
+
+    scheduleSave();
+}
+
+QList<QuickOpenIndex::Result> QuickOpenIndex::search(const QString &query, int limit) const
+{
+    const QStringList tokens = query.toLower().split(QChar(' '), Qt::SkipEmptyParts);
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    const quint32 total = count();
+
+    QList<quint32> keys;
+    for (const QString &token : tokens) {
+        keys.append(trigrams(token));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    struct Candidate
+    {
+        quint32 id;
+        double score;
+    };
+    std::vector<Candidate> candidates;
+
+    if (keys.isEmpty()) {
+        // Nothing to look up yet, short queries only search what was played
+        for (quint32 id = 0; id < m_base.pathCount; ++id) {
+            if (m_base.played[id] != 0 && !m_playedOverrides.contains(id)) {
+                candidates.push_back({id, recencyScore(m_base.played[id], now)});
+            }
+        }
+        for (auto it = m_playedOverrides.cbegin(); it != m_playedOverrides.cend(); ++it) {
+            candidates.push_back({it.key(), recencyScore(it.value(), now)});
+        }
+        for (quint32 id = m_base.pathCount; id < total; ++id) {
+            if (m_addedPlayed[id - m_base.pathCount] != 0) {
+                candidates.push_back({id, recencyScore(m_addedPlayed[id - m_base.pathCount], now)});
+            }
+        }
+    } else {
+        std::vector<Postings> lists;
+        lists.reserve(keys.size());
+        for (quint32 key : std::as_const(keys)) {
+            lists.push_back(postings(key));
+        }
+        std::sort(lists.begin(), lists.end(), [](const Postings &a, const Postings &b) {
+            return a.size() < b.size();
+        });
+
+        // Whatever reaches the threshold appears in at least one of the rarest lists
+        const int listCount = int(lists.size());
+        const int threshold = qMax(1, int(std::ceil(listCount * MIN_TRIGRAM_SHARE)));
+        const int rare = listCount - threshold + 1;
+
+        std::vector<quint32> ids;
+        for (int i = 0; i < rare; ++i) {
+            ids.insert(ids.end(), lists[i].base, lists[i].base + lists[i].baseSize);
+            if (lists[i].added) {
+                ids.insert(ids.end(), lists[i].added->cbegin(), lists[i].added->cend());
+            }
+        }
+        std::sort(ids.begin(), ids.end());
+
+        for (size_t i = 0; i < ids.size();) {
+            const quint32 id = ids[i];
+            int hits = 0;
+            while (i < ids.size() && ids[i] == id) {
+                ++hits;
+                ++i;
+            }
+
+            for (int k = rare; k < listCount && hits + (listCount - k) >= threshold; ++k) {
+                if (lists[k].contains(id, m_base.pathCount)) {
+                    ++hits;
+                }
+            }
+
+            if (hits >= threshold) {
+                candidates.push_back({id, double(hits) / listCount + recencyScore(playedAt(id), now)});
+            }
+        }
+    }
+
+    // Only the best candidates by trigram hits are decoded and ranked on their text
+    auto better = [](const Candidate &a, const Candidate &b) { return a.score > b.score; };
+    if (candidates.size() > size_t(MAX_RANKED)) {
+        std::nth_element(candidates.begin(), candidates.begin() + MAX_RANKED, candidates.end(), better);
+        candidates.resize(MAX_RANKED);
+    }
+
+    std::vector<Candidate> ranked;
+    ranked.reserve(candidates.size());
+    for (const Candidate &candidate : candidates) {
+        const QString text = indexText(pathAt(candidate.id));
+        const QStringView name = QStringView(text).mid(text.indexOf(QChar('/')) + 1);
+
+        double score = candidate.score - name.size() * 0.001;
+        bool rejected = false;
+        for (const QString &token : tokens) {
+            const qsizetype pos = name.indexOf(token);
+            if (pos >= 0) {
+                score += pos == 0 || !name[pos - 1].isLetterOrNumber() ? 1.5 : 1.0;
+            } else if (text.contains(token)) {
+                score += 0.5;
+            } else if (token.size() < 3) {
+                // Too short for trigrams, these have to match literally
+                rejected = true;
+                break;
+            }
+        }
+
+        if (!rejected) {
+            ranked.push_back({candidate.id, score});
+        }
+    }
+
+    const size_t resultCount = qMin(ranked.size(), size_t(qMax(0, limit)));
+    std::partial_sort(ranked.begin(), ranked.begin() + resultCount, ranked.end(), better);
+
+    QList<Result> results;
+    results.reserve(resultCount);
+    for (size_t i = 0; i < resultCount; ++i) {
+        results.append({pathAt(ranked[i].id), ranked[i].score});
+    }
+    return results;
+}
+
+void QuickOpenIndex::mapBase(bool validate)
+{
+    m_base = Base();
+
+    const QString path = indexPath();
+    if (!QFile::exists(path) && QFile::exists(path + ".new")) {
+        QFile::rename(path + ".new", path);
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const qint64 size = m_file.size();
+    m_map = size >= qint64(sizeof(Header)) ? m_file.map(0, size) : nullptr;
+    if (!m_map) {
+        m_file.close();
+        return;
+    }
+
+    Header header;
+    memcpy(&header, m_map, sizeof(Header));
+
+    // Every array is checked against the file size before it is used
+    const quint32 *words = reinterpret_cast<const quint32 *>(m_map + sizeof(Header));
+    const qint64 available = (size - qint64(sizeof(Header))) / 4;
+    qint64 used = qint64(header.pathCount) * 2 + 1 + qint64(header.trigramCount) * 2 + 1;
+    bool valid = header.magic == MAGIC && header.version == VERSION && used <= available;
+
+    Base base;
+    if (valid) {
+        base.pathCount = header.pathCount;
+        base.trigramCount = header.trigramCount;
+        base.hashSlots = header.hashSlots;
+        base.played = words;
+        base.stringOffsets = base.played + header.pathCount;
+        base.keys = base.stringOffsets + header.pathCount + 1;
+        base.postingOffsets = base.keys + header.trigramCount;
+        base.postings = base.postingOffsets + header.trigramCount + 1;
+
+        const quint32 postingCount = base.postingOffsets[header.trigramCount];
+        used += qint64(postingCount) + header.hashSlots;
+        valid = used <= available && (header.hashSlots & (header.hashSlots - 1)) == 0 &&
+                base.stringOffsets[header.pathCount] == header.stringBytes &&
+                used * 4 + qint64(sizeof(Header)) + header.stringBytes <= size;
+
+        if (valid) {
+            base.slots = base.postings + postingCount;
+            base.strings = reinterpret_cast<const char *>(base.slots + header.hashSlots);
+        }
+    }
+
+    if (!valid) {
+        qWarning() << "Ignoring invalid quick open index:" << path;
+        unmapBase();
+        return;
+    }
+
+    if (!validate) {
+        m_base = base;
+        return;
+    }
+
+    // The full pass reads every page of the file, lookups only see the file once it is done
+    m_validating = base;
+    m_validatePending = true;
+    m_validateWatcher.setFuture(QtConcurrent::run([base]() {
+        return isConsistent(base);
+    }));
+}
+
+void QuickOpenIndex::onValidated()
+{
+    if (!m_validatePending) {
+        return;
+    }
+    m_validatePending = false;
+
+    const Base base = m_validating;
+    m_validating = Base();
+    if (!m_validateWatcher.result()) {
+        qWarning() << "Ignoring invalid quick open index:" << m_file.fileName();
+        unmapBase();
+        return;
+    }
+
+    // Entries added in the meantime were numbered from zero, they go after the file's now
+    const QStringList addedPaths = m_addedPaths;
+    const QList<quint32> addedPlayed = m_addedPlayed;
+    m_addedPaths.clear();
+    m_addedPlayed.clear();
+    m_addedIds.clear();
+    m_addedPostings.clear();
+    m_base = base;
+
+    for (qsizetype i = 0; i < addedPaths.size(); ++i) {
+        qint64 id = findId(addedPaths[i]);
+        if (id < 0) {
+            id = add(addedPaths[i]);
+        }
+        if (addedPlayed[i] == 0) {
+            continue;
+        }
+        if (quint32(id) < m_base.pathCount) {
+            m_playedOverrides.insert(quint32(id), addedPlayed[i]);
+        } else {
+            m_addedPlayed[id - m_base.pathCount] = addedPlayed[i];
+        }
+    }
+}
+
+void QuickOpenIndex::unmapBase()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_file.close();
+}
+
+bool QuickOpenIndex::isConsistent(const Base &base)
+{
+    // Lookups index and binary search these arrays without further checks, one pass over them up front
+    if (base.pathCount >= base.hashSlots || base.stringOffsets[0] != 0 || base.postingOffsets[0] != 0) {
+        return false;
+    }
+
+    for (quint32 id = 0; id < base.pathCount; ++id) {
+        if (base.stringOffsets[id] > base.stringOffsets[id + 1]) {
+            return false;
+        }
+    }
+
+    for (quint32 index = 0; index < base.trigramCount; ++index) {
+        const quint32 begin = base.postingOffsets[index];
+        const quint32 end = base.postingOffsets[index + 1];
+        if (begin > end || (index > 0 && base.keys[index - 1] >= base.keys[index])) {
+            return false;
+        }
+        for (quint32 i = begin; i < end; ++i) {
+            if (base.postings[i] >= base.pathCount || (i > begin && base.postings[i - 1] >= base.postings[i])) {
+                return false;
+            }
+        }
+    }
+
+    // Every path sits in exactly one slot, which leaves free slots to end each probe
+    quint32 used = 0;
+    for (quint32 slot = 0; slot < base.hashSlots; ++slot) {
+        if (base.slots[slot] > base.pathCount) {
+            return false;
+        }
+        used += base.slots[slot] != 0;
+    }
+
+    return used == base.pathCount;
+}
+
+bool QuickOpenIndex::replaceBase()
+{
+    unmapBase();
+    m_base = Base();
+
+    // A mapped file cannot be replaced on Windows, so the new one is moved in only now
+    const QString path = indexPath();
+    QFile::remove(path);
+    if (!QFile::rename(path + ".new", path)) {
+        return false;
+    }
+
+    // Written from a checked base and the delta, so it is used right away
+    mapBase(false);
+    return m_map != nullptr;
+}
+
+void QuickOpenIndex::scheduleSave()
+{
+    m_dirty = true;
+    if (!m_saveTimer.isActive()) {
+        m_saveTimer.start();
+    }
+}
+
+void QuickOpenIndex::save()
+{
+    // Until the file is checked the delta can not be merged into it
+    if (m_savePending || m_validatePending) {
+        m_saveTimer.start();
+        return;
+    }
+    if (!m_dirty) {
+        return;
+    }
+
+    m_saving = Snapshot{m_base, m_addedPaths, m_addedPlayed, m_addedPostings, m_playedOverrides};
+    m_savePending = true;
+    m_dirty = false;
+
+    const QString path = indexPath() + ".new";
+    const Snapshot snapshot = m_saving;
+    m_saveWatcher.setFuture(QtConcurrent::run([path, snapshot]() {
+        return writeIndex(path, snapshot);
+    }));
+}
+
+void QuickOpenIndex::onSaved()
+{
+    if (!m_savePending) {
+        return;
+    }
+    m_savePending = false;
+
+    if (!m_saveWatcher.result()) {
+        qWarning() << "Could not write the quick open index";
+        m_saving = Snapshot();
+        scheduleSave();
+        return;
+    }
+
+    const quint32 oldCount = m_saving.base.pathCount;
+    const qsizetype saved = m_saving.addedPaths.size();
+
+    // Keep what changed while the file was written, it is newer than what the file holds
+    for (qsizetype i = 0; i < saved; ++i) {
+        if (m_addedPlayed[i] != m_saving.addedPlayed[i]) {
+            m_playedOverrides.insert(oldCount + quint32(i), m_addedPlayed[i]);
+        }
+    }
+    for (auto it = m_saving.playedOverrides.cbegin(); it != m_saving.playedOverrides.cend(); ++it) {
+        auto current = m_playedOverrides.find(it.key());
+        if (current != m_playedOverrides.end() && current.value() == it.value()) {
+            m_playedOverrides.erase(current);
+        }
+    }
+
+    const bool replaced = replaceBase();
+    if (!replaced || m_base.pathCount != oldCount + quint32(saved)) {
+        // Ids of the delta no longer line up with the file, start over from what it holds
+        qWarning() << "Could not reload the quick open index";
+        m_addedPaths.clear();
+        m_addedPlayed.clear();
+        m_addedIds.clear();
+        m_addedPostings.clear();
+        m_playedOverrides.clear();
+        m_saving = Snapshot();
+        return;
+    }
+
+    // Saved entries keep their ids, they just moved from the delta to the file
+    for (qsizetype i = 0; i < saved; ++i) {
+        m_addedIds.remove(m_addedPaths[i]);
+    }
+    m_addedPaths.remove(0, saved);
+    m_addedPlayed.remove(0, saved);
+
+    for (auto it = m_addedPostings.begin(); it != m_addedPostings.end();) {
+        QList<quint32> &ids = it.value();
+        ids.erase(ids.begin(), std::lower_bound(ids.begin(), ids.end(), m_base.pathCount));
+        it = ids.isEmpty() ? m_addedPostings.erase(it) : std::next(it);
+    }
+
+    m_saving = Snapshot();
+    if (m_dirty) {
+        m_saveTimer.start();
+    }
+}
+
+qint64 QuickOpenIndex::findId(const QString &path) const
+{
+    if (m_base.hashSlots > 0) {
+        const QByteArray utf8 = path.toUtf8();
+        const quint32 mask = m_base.hashSlots - 1;
+        quint32 slot = pathHash(utf8) & mask;
+        for (quint32 probes = 0; probes < m_base.hashSlots && m_base.slots[slot] != 0; ++probes, slot = (slot + 1) & mask) {
+            const quint32 id = m_base.slots[slot] - 1;
+            const quint32 begin = m_base.stringOffsets[id];
+            const quint32 length = m_base.stringOffsets[id + 1] - begin;
+            if (length == quint32(utf8.size()) && memcmp(m_base.strings + begin, utf8.constData(), length) == 0) {
+                return id;
+            }
+        }
+    }
+
+    auto added = m_addedIds.constFind(path);
+    return added != m_addedIds.cend() ? qint64(added.value()) : -1;
+}
+
+quint32 QuickOpenIndex::add(const QString &path)
+{
+    const quint32 id = count();
+    m_addedPaths.append(path);
+    m_addedPlayed.append(0);
+    m_addedIds.insert(path, id);
+
+    for (quint32 key : trigrams(indexText(path))) {
+        m_addedPostings[key].append(id);
+    }
+    return id;
+}
+
+quint32 QuickOpenIndex::playedAt(quint32 id) const
+{
+    if (id < m_base.pathCount) {
+        return m_playedOverrides.value(id, m_base.played[id]);
+    }
+    return m_addedPlayed[id - m_base.pathCount];
+}
+
+QString QuickOpenIndex::pathAt(quint32 id) const
+{
+    if (id < m_base.pathCount) {
+        const quint32 begin = m_base.stringOffsets[id];
+        return QString::fromUtf8(m_base.strings + begin, m_base.stringOffsets[id + 1] - begin);
+    }
+    return m_addedPaths[id - m_base.pathCount];
+}
+
+QuickOpenIndex::Postings QuickOpenIndex::postings(quint32 key) const
+{
+    Postings result;
+
+    const quint32 *keysEnd = m_base.keys + m_base.trigramCount;
+    const quint32 *found = std::lower_bound(m_base.keys, keysEnd, key);
+    if (found != keysEnd && *found == key) {
+        const qsizetype index = found - m_base.keys;
+        result.base = m_base.postings + m_base.postingOffsets[index];
+        result.baseSize = m_base.postingOffsets[index + 1] - m_base.postingOffsets[index];
+    }
+
+    auto added = m_addedPostings.constFind(key);
+    if (added != m_addedPostings.cend()) {
+        result.added = &added.value();
+    }
+    return result;
+}
+
+bool QuickOpenIndex::writeIndex(const QString &filePath, const Snapshot &snapshot)
+{
+    const Base &base = snapshot.base;
+    const quint32 total = base.pathCount + quint32(snapshot.addedPaths.size());
+
+    std::vector<quint32> played(base.played, base.played + base.pathCount);
+    for (auto it = snapshot.playedOverrides.cbegin(); it != snapshot.playedOverrides.cend(); ++it) {
+        if (it.key() < base.pathCount) {
+            played[it.key()] = it.value();
+        }
+    }
+    played.insert(played.end(), snapshot.addedPlayed.cbegin(), snapshot.addedPlayed.cend());
+
+    QList<QByteArray> addedStrings;
+    std::vector<quint32> stringOffsets(base.stringOffsets, base.stringOffsets + base.pathCount);
+    quint32 stringBytes = base.pathCount > 0 ? base.stringOffsets[base.pathCount] : 0;
+    for (const QString &path : snapshot.addedPaths) {
+        stringOffsets.push_back(stringBytes);
+        addedStrings.append(path.toUtf8());
+        stringBytes += quint32(addedStrings.last().size());
+    }
+    stringOffsets.push_back(stringBytes);
+
+    // Added ids are all above the file's, so merged lists stay sorted by appending
+    QList<quint32> addedKeys = snapshot.addedPostings.keys();
+    std::sort(addedKeys.begin(), addedKeys.end());
+
+    std::vector<quint32> keys;
+    std::vector<quint32> postingOffsets;
+    std::vector<quint32> postings;
+    keys.reserve(base.trigramCount + addedKeys.size());
+    postings.reserve((base.trigramCount > 0 ? base.postingOffsets[base.trigramCount] : 0) + total);
+
+    quint32 i = 0;
+    qsizetype j = 0;
+    while (i < base.trigramCount || j < addedKeys.size()) {
+        const bool takeBase = i < base.trigramCount && (j == addedKeys.size() || base.keys[i] <= addedKeys[j]);
+        const bool takeAdded = j < addedKeys.size() && (i == base.trigramCount || addedKeys[j] <= base.keys[i]);
+        const quint32 key = takeBase ? base.keys[i] : addedKeys[j];
+
+        keys.push_back(key);
+        postingOffsets.push_back(quint32(postings.size()));
+        if (takeBase) {
+            postings.insert(postings.end(), base.postings + base.postingOffsets[i],
+                            base.postings + base.postingOffsets[i + 1]);
+            ++i;
+        }
+        if (takeAdded) {
+            const QList<quint32> &ids = snapshot.addedPostings[key];
+            postings.insert(postings.end(), ids.cbegin(), ids.cend());
+            ++j;
+        }
+    }
+    postingOffsets.push_back(quint32(postings.size()));
+
+    quint32 hashSlots = 16;
+    while (hashSlots < total * 2) {
+        hashSlots *= 2;
+    }
+    std::vector<quint32> slots(hashSlots, 0);
+    for (quint32 id = 0; id < total; ++id) {
+        const QByteArray utf8 = id < base.pathCount
+            ? QByteArray::fromRawData(base.strings + base.stringOffsets[id],
+                                      base.stringOffsets[id + 1] - base.stringOffsets[id])
+            : addedStrings[id - base.pathCount];
+        quint32 slot = pathHash(utf8) & (hashSlots - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (hashSlots - 1);
+        }
+        slots[slot] = id + 1;
+    }
+
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    const Header header{MAGIC, VERSION, total, quint32(keys.size()), hashSlots, stringBytes};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    writeArray(file, played.data(), played.size());
+    writeArray(file, stringOffsets.data(), stringOffsets.size());
+    writeArray(file, keys.data(), keys.size());
+    writeArray(file, postingOffsets.data(), postingOffsets.size());
+    writeArray(file, postings.data(), postings.size());
+    writeArray(file, slots.data(), slots.size());
+    if (base.pathCount > 0) {
+        file.write(base.strings, base.stringOffsets[base.pathCount]);
+    }
+    for (const QByteArray &utf8 : std::as_const(addedStrings)) {
+        file.write(utf8);
+    }
+
+    return file.commit();
+}
+
+QString QuickOpenIndex::indexText(const QString &path)
+{
+    QString folder;
+    QString name;
+
+    if (path.startsWith("file://")) {
+        // Archive member: the archive stands in for the folder
+        const QUrl url(path);
+        const QString member = url.fragment(QUrl::FullyDecoded);
+        name = member.mid(member.lastIndexOf(QChar('/')) + 1);
+        folder = QFileInfo(url.toLocalFile()).completeBaseName();
+    } else {
+        const qsizetype slash = qMax(path.lastIndexOf(QChar('/')), path.lastIndexOf(QChar('\\')));
+        name = path.mid(slash + 1);
+        if (slash > 0) {
+            const qsizetype parent = qMax(path.lastIndexOf(QChar('/'), slash - 1),
+                                          path.lastIndexOf(QChar('\\'), slash - 1));
+            folder = path.mid(parent + 1, slash - parent - 1);
+        }
+    }
+
+    const qsizetype dot = name.lastIndexOf(QChar('.'));
+    if (dot > 0) {
+        name.truncate(dot);
+    }
+
+    return (folder + QChar('/') + name).toLower();
+}
+
+QList<quint32> QuickOpenIndex::trigrams(const QString &text)
+{
+    QList<quint32> keys;
+    for (qsizetype i = 0; i + 2 < text.size(); ++i) {
+        const quint32 a = text[i].unicode();
+        const quint32 b = text[i + 1].unicode();
+        const quint32 c = text[i + 2].unicode();
+        if ((a | b | c) < 128) {
+            keys.append((a << 16) | (b << 8) | c);
+        } else {
+            keys.append(0x80000000u | (((a * 0x9E3779B1u) ^ (b * 0x85EBCA77u) ^ (c * 0xC2B2AE3Du)) >> 1));
+        }
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+quint32 QuickOpenIndex::pathHash(const QByteArray &utf8)
+{
+    quint32 hash = 2166136261u;
+    for (char c : utf8) {
+        hash = (hash ^ uchar(c)) * 16777619u;
+    }
+    return hash;
+}
+
+QString QuickOpenIndex::indexPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/quickopen.idx";
+}
@@ -0,0 +1,244 @@
+#include "readaheaddevice.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QDebug>
+#include <cstring>
+
+ReadAheadDevice::ReadAheadDevice(QIODevice *upstream, QObject *parent)
+    : QIODevice(parent), m_upstream(upstream), m_worker(nullptr), m_size(upstream ? upstream->size() : 0),
+    m_head(0), m_bufferStart(0), m_bufferLength(0), m_readPos(0), m_behindPending(0), m_generation(0),
+    m_error(false), m_stop(false), m_stallCount(0), m_stallTimeUs(0), m_bytesFetched(0), m_restartCount(0)
+{
+    if (m_upstream) {
+        m_upstream->setParent(nullptr);
+    }
+}
+
+ReadAheadDevice::~ReadAheadDevice()
+{
+    stopWorker();
+}
+
+bool ReadAheadDevice::open(OpenMode mode)
+{
+    if ((mode & QIODevice::WriteOnly) || !m_upstream || !m_upstream->isReadable()) {
+        return false;
+    }
+
+    // Our own ring buffer replaces QIODevice's internal one
+    if (!QIODevice::open(mode | QIODevice::Unbuffered)) {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_buffer.resize(CAPACITY);
+        m_chunk.resize(CHUNK_SIZE);
+        m_stop = false;
+        m_error = false;
+        restartAt(0);
+    }
+
+    m_worker = QThread::create([this]() { run(); });
+    m_worker->setObjectName("ReadAheadDevice");
+    m_worker->start();
+    return true;
+}
+
+void ReadAheadDevice::close()
+{
+    stopWorker();
+    QIODevice::close();
+}
+
+bool ReadAheadDevice::seek(qint64 pos)
+{
+    if (!QIODevice::seek(pos)) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_readPos = pos;
+    if (pos < m_bufferStart || pos > m_bufferStart + m_bufferLength) {
+        restartAt(pos);
+    }
+    m_workAvailable.wakeOne();
+    return true;
+}
+
+qint64 ReadAheadDevice::readData(char *data, qint64 maxSize)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_readPos < m_bufferStart || m_readPos > m_bufferStart + m_bufferLength) {
+        restartAt(m_readPos);
+    }
+
+    qint64 stallUs = -1;
+    if (m_readPos >= m_bufferStart + m_bufferLength && m_readPos < m_size && !m_error && !m_stop) {
+        QElapsedTimer timer;
+        timer.start();
+        m_workAvailable.wakeOne();
+        while (m_readPos >= m_bufferStart + m_bufferLength && m_readPos < m_size && !m_error && !m_stop) {
+            m_dataAvailable.wait(&m_mutex);
+        }
+        stallUs = timer.nsecsElapsed() / 1000;
+    }
+
+    qint64 result = 0;
+    if (m_error && m_readPos >= m_bufferStart + m_bufferLength) {
+        result = -1;
+    } else {
+        const qint64 available = m_bufferStart + m_bufferLength - m_readPos;
+        result = qMin(maxSize, available);
+        if (result > 0) {
+            copyFromRing(m_head + (m_readPos - m_bufferStart), data, result);
+            m_readPos += result;
+            m_workAvailable.wakeOne();
+        }
+    }
+    locker.unlock();
+
+    if (stallUs >= 0) {
+        m_stallCount.fetch_add(1, std::memory_order_relaxed);
+        m_stallTimeUs.fetch_add(stallUs, std::memory_order_relaxed);
+        emit stalled(stallUs);
+    }
+
+    return result;
+}
+
+qint64 ReadAheadDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
+
+void ReadAheadDevice::run()
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_stop) {
+        // Drop what the reader has left far enough behind to make room
+        const qint64 keepFrom = m_readPos - BACKLOG_SIZE;
+        if (keepFrom > m_bufferStart) {
+            discardFront(qMin(keepFrom - m_bufferStart, m_bufferLength));
+        }
+
+        const qint64 fetchEnd = m_bufferStart + m_bufferLength;
+        const qint64 freeSpace = CAPACITY - m_bufferLength;
+        const bool forwardDone = fetchEnd >= m_size;
+        qint64 offset = 0;
+        qint64 length = 0;
+        bool behind = false;
+
+        if (!m_error && m_behindPending > 0 && (forwardDone || fetchEnd - m_readPos >= CHUNK_SIZE)) {
+            length = qMin(qMin(m_behindPending, freeSpace), CHUNK_SIZE);
+            offset = m_bufferStart - length;
+            behind = true;
+        } else if (!m_error && !forwardDone) {
+            length = qMin(qMin(CHUNK_SIZE, freeSpace), m_size - fetchEnd);
+            offset = fetchEnd;
+        }
+
+        if (length <= 0) {
+            m_workAvailable.wait(&m_mutex);
+            continue;
+        }
+
+        const quint64 generation = m_generation;
+        char *chunk = m_chunk.data();
+        locker.unlock();
+
+        qint64 bytesRead = -1;
+        if (m_upstream->seek(offset)) {
+            bytesRead = m_upstream->read(chunk, length);
+        }
+
+        locker.relock();
+        if (generation != m_generation) {
+            continue;
+        }
+
+        if (behind) {
+            // A partial chunk cannot be placed in front of the buffer, skip it
+            m_behindPending = 0;
+            if (bytesRead == length) {
+                m_head = (m_head - length + CAPACITY) % CAPACITY;
+                copyIntoRing(m_head, chunk, length);
+                m_bufferStart -= length;
+                m_bufferLength += length;
+            }
+        } else if (bytesRead > 0) {
+            copyIntoRing(m_head + m_bufferLength, chunk, bytesRead);
+            m_bufferLength += bytesRead;
+        } else {
+            qWarning() << "ReadAheadDevice: upstream read failed at" << offset;
+            m_error = true;
+        }
+
+        if (bytesRead > 0) {
+            m_bytesFetched.fetch_add(bytesRead, std::memory_order_relaxed);
+            emit bytesFetched(bytesRead);
+        }
+        m_dataAvailable.wakeAll();
+    }
+}
+
+void ReadAheadDevice::stopWorker()
+{
+    if (!m_worker) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stop = true;
+        m_workAvailable.wakeAll();
+        m_dataAvailable.wakeAll();
+    }
+
+    m_worker->wait();
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+void ReadAheadDevice::restartAt(qint64 pos)
+{
+    ++m_generation;
+    m_restartCount.fetch_add(1, std::memory_order_relaxed);
+    m_head = 0;
+    m_bufferStart = pos;
+    m_bufferLength = 0;
+    m_behindPending = qMin(pos, BEHIND_SIZE);
+    m_error = false;
+    m_workAvailable.wakeOne();
+}
+
+void ReadAheadDevice::discardFront(qint64 bytes)
+{
+    m_head = (m_head + bytes) % CAPACITY;
+    m_bufferStart += bytes;
+    m_bufferLength -= bytes;
+    // Whatever was due before the buffer is now behind the reader anyway
+    m_behindPending = 0;
+}
+
+void ReadAheadDevice::copyIntoRing(qint64 ringOffset, const char *data, qint64 length)
+{
+    char *ring = m_buffer.data();
+    ringOffset %= CAPACITY;
+    const qint64 first = qMin(length, CAPACITY - ringOffset);
+    std::memcpy(ring + ringOffset, data, first);
+    std::memcpy(ring, data + first, length - first);
+}
+
+void ReadAheadDevice::copyFromRing(qint64 ringOffset, char *data, qint64 length) const
+{
+    const char *ring = m_buffer.constData();
+    ringOffset %= CAPACITY;
+    const qint64 first = qMin(length, CAPACITY - ringOffset);
+    std::memcpy(data, ring + ringOffset, first);
+    std::memcpy(data + first, ring, length - first);
+}
@@ -0,0 +1,122 @@
+#include "realfft.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REALFFT_SSE 1
+#endif
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+}
+
+RealFft::RealFft(int size)
+    : m_size(size), m_half(size / 2), m_bitReverse(m_half), m_unpackCos(m_half), m_unpackSin(m_half),
+    m_re(m_half), m_im(m_half)
+{
+    int bits = 0;
+    while ((1 << bits) < m_half) {
+        ++bits;
+    }
+
+    for (int i = 0; i < m_half; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bitReverse[i] = reversed;
+    }
+
+    // Stage with span `half` keeps its twiddles at offset half - 1
+    m_stageCos.reserve(m_half);
+    m_stageSin.reserve(m_half);
+    for (int half = 1; half < m_half; half *= 2) {
+        for (int k = 0; k < half; ++k) {
+            const double angle = -PI * k / half;
+            m_stageCos.push_back(float(std::cos(angle)));
+            m_stageSin.push_back(float(std::sin(angle)));
+        }
+    }
+
+    for (int k = 0; k < m_half; ++k) {
+        const double angle = -2.0 * PI * k / m_size;
+        m_unpackCos[k] = float(std::cos(angle));
+        m_unpackSin[k] = float(std::sin(angle));
+    }
+}
+
+void RealFft::powerSpectrum(const float *input, float *power)
+{
+    // Even samples become the real part, odd samples the imaginary part
+    for (int i = 0; i < m_half; ++i) {
+        const int j = m_bitReverse[i];
+        m_re[j] = input[2 * i];
+        m_im[j] = input[2 * i + 1];
+    }
+
+    transform();
+
+    const float *re = m_re.data();
+    const float *im = m_im.data();
+
+    // Split the half-length result back into the spectrum of the real input
+    power[0] = (re[0] + im[0]) * (re[0] + im[0]);
+    for (int k = 1; k < m_half; ++k) {
+        const int m = m_half - k;
+        const float evenRe = 0.5f * (re[k] + re[m]);
+        const float evenIm = 0.5f * (im[k] - im[m]);
+        const float oddRe = 0.5f * (im[k] + im[m]);
+        const float oddIm = -0.5f * (re[k] - re[m]);
+        const float c = m_unpackCos[k];
+        const float s = m_unpackSin[k];
+        const float xRe = evenRe + c * oddRe - s * oddIm;
+        const float xIm = evenIm + c * oddIm + s * oddRe;
+        power[k] = xRe * xRe + xIm * xIm;
+    }
+}
+
+void RealFft::transform()
+{
+    float *re = m_re.data();
+    float *im = m_im.data();
+
+    for (int half = 1; half < m_half; half *= 2) {
+        const float *wr = m_stageCos.data() + half - 1;
+        const float *wi = m_stageSin.data() + half - 1;
+
+        for (int start = 0; start < m_half; start += 2 * half) {
+            float *aRe = re + start;
+            float *aIm = im + start;
+            float *bRe = aRe + half;
+            float *bIm = aIm + half;
+            int k = 0;
+
+#ifdef REALFFT_SSE
+            for (; k + 4 <= half; k += 4) {
+                const __m128 cr = _mm_loadu_ps(wr + k);
+                const __m128 ci = _mm_loadu_ps(wi + k);
+                const __m128 xr = _mm_loadu_ps(bRe + k);
+                const __m128 xi = _mm_loadu_ps(bIm + k);
+                const __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci));
+                const __m128 ti = _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr));
+                const __m128 ur = _mm_loadu_ps(aRe + k);
+                const __m128 ui = _mm_loadu_ps(aIm + k);
+                _mm_storeu_ps(aRe + k, _mm_add_ps(ur, tr));
+                _mm_storeu_ps(aIm + k, _mm_add_ps(ui, ti));
+                _mm_storeu_ps(bRe + k, _mm_sub_ps(ur, tr));
+                _mm_storeu_ps(bIm + k, _mm_sub_ps(ui, ti));
+            }
+#endif
+            for (; k < half; ++k) {
+                const float tr = bRe[k] * wr[k] - bIm[k] * wi[k];
+                const float ti = bRe[k] * wi[k] + bIm[k] * wr[k];
+                bRe[k] = aRe[k] - tr;
+                bIm[k] = aIm[k] - ti;
+                aRe[k] += tr;
+                aIm[k] += ti;
+            }
+        }
+    }
+}
@@ -0,0 +1,219 @@
+#include "shuffleorder.h"
+
+namespace {
+
+quint64 splitMix64(quint64 &state)
+{
+    quint64 z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+int bitWidth(quint64 value)
+{
+    int bits = 0;
+    while (value) {
+        ++bits;
+        value >>= 1;
+    }
+    return bits;
+}
+
+}
+
+ShuffleOrder::ShuffleOrder()
+    : m_size(0), m_halfBits(0), m_halfMask(0), m_domainMask(0), m_keys{},
+    m_origin(0), m_maxVisited(0), m_seed(0)
+{
+}
+
+void ShuffleOrder::reset(int size, int startIndex, quint64 seed)
+{
+    clear();
+    if (size <= 0 || startIndex < 0 || startIndex >= size) {
+        return;
+    }
+
+    // Keep the domain well above the playlist size so it can grow in place
+    int bits = qMax(2, bitWidth(quint64(size - 1)) + HEADROOM_BITS);
+    bits += bits % 2;
+
+    m_size = size;
+    m_seed = seed;
+    m_halfBits = bits / 2;
+    m_halfMask = (quint64(1) << m_halfBits) - 1;
+    m_domainMask = (quint64(1) << bits) - 1;
+
+    quint64 state = seed;
+    for (int i = 0; i < ROUNDS; ++i) {
+        m_keys[i] = splitMix64(state);
+    }
+
+    m_origin = invert(quint64(startIndex));
+}
+
+void ShuffleOrder::clear()
+{
+    m_size = 0;
+    m_origin = 0;
+    m_maxVisited = 0;
+    m_growth.clear();
+    m_prefix.clear();
+    m_prefixPositions.clear();
+}
+
+void ShuffleOrder::grow(int newSize)
+{
+    if (!isValid() || newSize <= m_size) {
+        return;
+    }
+
+    if (quint64(newSize - 1) > m_domainMask) {
+        // A larger domain is a different permutation, what was played so far is kept as it was
+        const QList<int> played = playedOrder();
+        reset(newSize, played.last(), m_seed);
+        m_prefix = played;
+        for (int i = 0; i < m_prefix.size(); ++i) {
+            m_prefixPositions.insert(m_prefix[i], i);
+        }
+        return;
+    }
+
+    m_growth.append(qMakePair(m_maxVisited, m_size));
+    m_size = newSize;
+}
+
+void ShuffleOrder::visit(int index)
+{
+    if (!isValid() || index < 0 || index >= m_size || m_prefixPositions.contains(index)) {
+        return;
+    }
+
+    m_maxVisited = qMax(m_maxVisited, distanceOf(index));
+}
+
+int ShuffleOrder::startIndex() const
+{
+    if (!isValid()) {
+        return -1;
+    }
+    return m_prefix.isEmpty() ? int(permute(m_origin)) : m_prefix.first();
+}
+
+int ShuffleOrder::next(int index) const
+{
+    if (!isValid() || index < 0 || index >= m_size) {
+        return -1;
+    }
+
+    quint64 step = 1;
+    const int prefixPosition = m_prefixPositions.value(index, -1);
+    if (prefixPosition >= 0) {
+        if (prefixPosition + 1 < m_prefix.size()) {
+            return m_prefix[prefixPosition + 1];
+        }
+    } else {
+        step = distanceOf(index) + 1;
+    }
+
+    for (; step <= m_domainMask; ++step) {
+        const int value = valueAt(step);
+        if (value >= 0) {
+            return value;
+        }
+    }
+
+    return -1;
+}
+
+int ShuffleOrder::previous(int index) const
+{
+    if (!isValid() || index < 0 || index >= m_size) {
+        return -1;
+    }
+
+    const int prefixPosition = m_prefixPositions.value(index, -1);
+    if (prefixPosition >= 0) {
+        return prefixPosition > 0 ? m_prefix[prefixPosition - 1] : -1;
+    }
+
+    for (quint64 step = distanceOf(index); step-- > 0;) {
+        const int value = valueAt(step);
+        if (value >= 0) {
+            return value;
+        }
+    }
+
+    return m_prefix.isEmpty() ? -1 : m_prefix.last();
+}
+
+quint64 ShuffleOrder::permute(quint64 position) const
+{
+    quint64 left = position >> m_halfBits;
+    quint64 right = position & m_halfMask;
+
+    for (int i = 0; i < ROUNDS; ++i) {
+        quint64 mixed = left ^ roundFunction(right, i);
+        left = right;
+        right = mixed;
+    }
+
+    return (left << m_halfBits) | right;
+}
+
+quint64 ShuffleOrder::invert(quint64 value) const
+{
+    quint64 left = value >> m_halfBits;
+    quint64 right = value & m_halfMask;
+
+    for (int i = ROUNDS - 1; i >= 0; --i) {
+        quint64 mixed = right ^ roundFunction(left, i);
+        right = left;
+        left = mixed;
+    }
+
+    return (left << m_halfBits) | right;
+}
+
+quint64 ShuffleOrder::roundFunction(quint64 half, int round) const
+{
+    quint64 state = half ^ m_keys[round];
+    return splitMix64(state) & m_halfMask;
+}
+
+quint64 ShuffleOrder::distanceOf(int index) const
+{
+    return (invert(quint64(index)) - m_origin) & m_domainMask;
+}
+
+int ShuffleOrder::valueAt(quint64 step) const
+{
+    const quint64 value = permute((m_origin + step) & m_domainMask);
+    if (value >= quint64(sizeAt(step)) || m_prefixPositions.contains(int(value))) {
+        return -1;
+    }
+    return int(value);
+}
+
+QList<int> ShuffleOrder::playedOrder() const
+{
+    QList<int> order = m_prefix;
+    for (quint64 step = 0; step <= m_maxVisited; ++step) {
+        const int value = valueAt(step);
+        if (value >= 0) {
+            order.append(value);
+        }
+    }
+    return order;
+}
+
+int ShuffleOrder::sizeAt(quint64 distance) const
+{
+    for (const auto &growth : m_growth) {
+        if (distance <= growth.first) {
+            return growth.second;
+        }
+    }
+    return m_size;
+}
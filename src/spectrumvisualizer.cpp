@@ -0,0 +1,360 @@
+#include "spectrumvisualizer.h"
+#include <QSGGeometryNode>
+#include <QSGFlatColorMaterial>
+#include <QtEndian>
+#include <cmath>
+
+namespace {
+
+template <typename T>
+void downmix(const uchar *data, int frames, int channels, float scale, float offset, float *out)
+{
+    const float gain = scale / channels;
+    for (int frame = 0; frame < frames; ++frame) {
+        float sum = 0;
+        for (int channel = 0; channel < channels; ++channel) {
+            sum += float(qFromUnaligned<T>(data)) - offset;
+            data += sizeof(T);
+        }
+        out[frame] = sum * gain;
+    }
+}
+
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(TripleBuffer<SpectrumFrame> *output, QObject *parent)
+    : QObject(parent), m_output(output), m_fft(FFT_SIZE), m_window(FFT_SIZE), m_history(FFT_SIZE, 0.0f),
+    m_windowed(FFT_SIZE), m_power(FFT_SIZE / 2), m_powerScale(1.0f), m_historyPos(0), m_pendingSamples(0),
+    m_sampleRate(0), m_barCount(48)
+{
+    double windowSum = 0;
+    for (int i = 0; i < FFT_SIZE; ++i) {
+        m_window[i] = float(0.5 - 0.5 * std::cos(2.0 * 3.14159265358979323846 * i / (FFT_SIZE - 1)));
+        windowSum += m_window[i];
+    }
+
+    // A full scale sine ends up at 0 dB
+    m_powerScale = float(4.0 / (windowSum * windowSum));
+}
+
+void SpectrumAnalyzer::processBuffer(const QAudioBuffer &buffer)
+{
+    if (!buffer.isValid() || buffer.frameCount() == 0) {
+        return;
+    }
+
+    const int sampleRate = buffer.format().sampleRate();
+    if (sampleRate != m_sampleRate) {
+        m_sampleRate = sampleRate;
+        updateBands();
+    }
+
+    appendSamples(buffer);
+
+    // Only the most recent block matters, anything older was never going to be drawn
+    if (m_pendingSamples >= m_sampleRate / ANALYSIS_RATE) {
+        m_pendingSamples = 0;
+        analyze();
+    }
+}
+
+void SpectrumAnalyzer::setBarCount(int count)
+{
+    m_barCount = qBound(1, count, SpectrumFrame::MAX_BARS);
+    updateBands();
+}
+
+void SpectrumAnalyzer::clear()
+{
+    std::fill(m_history.begin(), m_history.end(), 0.0f);
+    m_historyPos = 0;
+    m_pendingSamples = 0;
+}
+
+void SpectrumAnalyzer::appendSamples(const QAudioBuffer &buffer)
+{
+    const QAudioFormat format = buffer.format();
+    const int channels = format.channelCount();
+    const int frames = int(buffer.frameCount());
+    const uchar *data = buffer.constData<uchar>();
+
+    if (channels <= 0) {
+        return;
+    }
+
+    m_mono.resize(frames);
+    switch (format.sampleFormat()) {
+    case QAudioFormat::UInt8:
+        downmix<quint8>(data, frames, channels, 1.0f / 128, 128, m_mono.data());
+        break;
+    case QAudioFormat::Int16:
+        downmix<qint16>(data, frames, channels, 1.0f / 32768, 0, m_mono.data());
+        break;
+    case QAudioFormat::Int32:
+        downmix<qint32>(data, frames, channels, 1.0f / 2147483648.0f, 0, m_mono.data());
+        break;
+    case QAudioFormat::Float:
+        downmix<float>(data, frames, channels, 1.0f, 0, m_mono.data());
+        break;
+    default:
+        return;
+    }
+
+    // Keep only the tail that fits the history ring
+    const int skip = qMax(0, frames - FFT_SIZE);
+    for (int i = skip; i < frames; ++i) {
+        m_history[m_historyPos] = m_mono[i];
+        m_historyPos = (m_historyPos + 1) & (FFT_SIZE - 1);
+    }
+    m_pendingSamples += frames;
+}
+
+void SpectrumAnalyzer::analyze()
+{
+    if (m_bandEdges.size() < size_t(m_barCount) + 1) {
+        return;
+    }
+
+    for (int i = 0; i < FFT_SIZE; ++i) {
+        m_windowed[i] = m_history[(m_historyPos + i) & (FFT_SIZE - 1)] * m_window[i];
+    }
+
+    m_fft.powerSpectrum(m_windowed.data(), m_power.data());
+
+    SpectrumFrame &frame = m_output->back();
+    frame.count = m_barCount;
+
+    for (int band = 0; band < m_barCount; ++band) {
+        const int first = m_bandEdges[band];
+        const int last = m_bandEdges[band + 1];
+        float sum = 0;
+        for (int bin = first; bin < last; ++bin) {
+            sum += m_power[bin];
+        }
+
+        const float db = 10.0f * std::log10(sum / (last - first) * m_powerScale + 1e-12f);
+        frame.levels[band] = qBound(0.0f, (db - FLOOR_DB) / -FLOOR_DB, 1.0f);
+    }
+
+    m_output->publish();
+    emit frameReady();
+}
+
+void SpectrumAnalyzer::updateBands()
+{
+    m_bandEdges.clear();
+    if (m_sampleRate <= 0) {
+        return;
+    }
+
+    const int bins = FFT_SIZE / 2;
+    const float binWidth = float(m_sampleRate) / FFT_SIZE;
+    const float high = qMin(MAX_FREQUENCY, m_sampleRate / 2.0f);
+    const float ratio = high / MIN_FREQUENCY;
+
+    // Bands are spaced evenly in log frequency, each at least one bin wide
+    int previous = qMax(1, int(std::lround(MIN_FREQUENCY / binWidth)));
+    m_bandEdges.push_back(previous);
+    for (int band = 1; band <= m_barCount; ++band) {
+        const float frequency = MIN_FREQUENCY * std::pow(ratio, float(band) / m_barCount);
+        const int edge = qMin(bins, qMax(previous + 1, int(std::lround(frequency / binWidth))));
+        m_bandEdges.push_back(edge);
+        previous = edge;
+    }
+
+    if (m_bandEdges.back() > bins || m_bandEdges[m_barCount - 1] >= bins) {
+        m_bandEdges.clear();
+    }
+}
+
+SpectrumVisualizer::SpectrumVisualizer(QQuickItem *parent)
+    : QQuickItem(parent), m_active(false), m_barCount(48), m_color(Qt::white), m_bufferOutput(nullptr),
+    m_analyzer(new SpectrumAnalyzer(&m_frames)), m_lastRender(0), m_lastFrame(-STALE_MS)
+{
+    setFlag(ItemHasContents, true);
+    m_levels.fill(0.0f);
+    m_renderClock.start();
+
+    m_analyzer->setBarCount(m_barCount);
+    m_analyzer->moveToThread(&m_thread);
+    m_thread.setObjectName("SpectrumAnalyzer");
+    m_thread.start(QThread::LowPriority);
+
+    connect(m_analyzer, &SpectrumAnalyzer::frameReady, this, &QQuickItem::update);
+}
+
+SpectrumVisualizer::~SpectrumVisualizer()
+{
+    detach();
+    m_thread.quit();
+    m_thread.wait();
+    delete m_analyzer;
+}
+
+void SpectrumVisualizer::setPlayer(QMediaPlayer *player)
+{
+    if (m_player == player) {
+        return;
+    }
+
+    detach();
+    if (m_player) {
+        disconnect(m_player, nullptr, m_analyzer, nullptr);
+    }
+
+    m_player = player;
+
+    if (m_player) {
+        connect(m_player, &QMediaPlayer::sourceChanged, m_analyzer, &SpectrumAnalyzer::clear);
+    }
+    attach();
+
+    emit playerChanged();
+}
+
+void SpectrumVisualizer::setActive(bool active)
+{
+    if (m_active == active) {
+        return;
+    }
+
+    m_active = active;
+    if (m_active) {
+        attach();
+    } else {
+        detach();
+    }
+    update();
+
+    emit activeChanged();
+}
+
+void SpectrumVisualizer::setBarCount(int count)
+{
+    count = qBound(1, count, SpectrumFrame::MAX_BARS);
+    if (m_barCount == count) {
+        return;
+    }
+
+    m_barCount = count;
+    QMetaObject::invokeMethod(m_analyzer, [this, count]() { m_analyzer->setBarCount(count); });
+    update();
+
+    emit barCountChanged();
+}
+
+void SpectrumVisualizer::setColor(const QColor &color)
+{
+    if (m_color == color) {
+        return;
+    }
+
+    m_color = color;
+    update();
+
+    emit colorChanged();
+}
+
+void SpectrumVisualizer::attach()
+{
+    if (!m_active || !m_player || m_bufferOutput) {
+        return;
+    }
+
+    // No format requested, buffers arrive as decoded and are converted on the worker
+    m_bufferOutput = new QAudioBufferOutput(this);
+    connect(m_bufferOutput, &QAudioBufferOutput::audioBufferReceived, m_analyzer, &SpectrumAnalyzer::processBuffer);
+    m_player->setAudioBufferOutput(m_bufferOutput);
+}
+
+void SpectrumVisualizer::detach()
+{
+    if (!m_bufferOutput) {
+        return;
+    }
+
+    if (m_player && m_player->audioBufferOutput() == m_bufferOutput) {
+        m_player->setAudioBufferOutput(nullptr);
+    }
+    delete m_bufferOutput;
+    m_bufferOutput = nullptr;
+
+    QMetaObject::invokeMethod(m_analyzer, &SpectrumAnalyzer::clear);
+}
+
+QSGNode *SpectrumVisualizer::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data)
+
+    auto *node = static_cast<QSGGeometryNode *>(oldNode);
+    if (!node) {
+        node = new QSGGeometryNode;
+        auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        node->setGeometry(geometry);
+        node->setFlag(QSGNode::OwnsGeometry);
+        node->setMaterial(new QSGFlatColorMaterial);
+        node->setFlag(QSGNode::OwnsMaterial);
+    }
+
+    const qint64 now = m_renderClock.elapsed();
+    const float elapsed = float(now - m_lastRender);
+    m_lastRender = now;
+
+    if (m_frames.update()) {
+        m_lastFrame = now;
+    }
+
+    const SpectrumFrame &frame = m_frames.front();
+    const bool stale = !m_active || now - m_lastFrame > STALE_MS;
+    const float release = std::exp(-elapsed / RELEASE_MS);
+    bool moving = false;
+
+    // Rise immediately, fall back smoothly whatever the analysis rate is
+    for (int bar = 0; bar < m_barCount; ++bar) {
+        const float target = stale || bar >= frame.count ? 0.0f : frame.levels[bar];
+        float &level = m_levels[bar];
+        level = target >= level ? target : target + (level - target) * release;
+        if (level > 0.002f) {
+            moving = true;
+        } else {
+            level = 0.0f;
+        }
+    }
+
+    QSGGeometry *geometry = node->geometry();
+    geometry->allocate(m_barCount * 6);
+    QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
+
+    const float slot = float(width()) / m_barCount;
+    const float gap = qMin(slot * 0.25f, 4.0f);
+    const float bottom = float(height());
+
+    for (int bar = 0; bar < m_barCount; ++bar) {
+        const float left = bar * slot + gap / 2;
+        const float right = left + slot - gap;
+        const float top = bottom - m_levels[bar] * bottom;
+        QSGGeometry::Point2D *v = vertices + bar * 6;
+        v[0].set(left, top);
+        v[1].set(right, top);
+        v[2].set(left, bottom);
+        v[3].set(right, top);
+        v[4].set(right, bottom);
+        v[5].set(left, bottom);
+    }
+    node->markDirty(QSGNode::DirtyGeometry);
+
+    auto *material = static_cast<QSGFlatColorMaterial *>(node->material());
+    if (material->color() != m_color) {
+        material->setColor(m_color);
+        node->markDirty(QSGNode::DirtyMaterial);
+    }
+
+    // Keep redrawing on the render clock while anything is visible, so bars
+    // also settle when analysis frames stop coming
+    if (moving) {
+        QMetaObject::invokeMethod(this, &QQuickItem::update, Qt::QueuedConnection);
+    }
+
+    return node;
+}
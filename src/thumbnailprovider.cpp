@@ -0,0 +1,342 @@
+#include "thumbnailprovider.h"
+#include "archivereader.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QMediaMetaData>
+#include <QMediaPlayer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QTimer>
+#include <QTimeZone>
+#include <QUrl>
+#include <QVideoFrame>
+#include <QVideoSink>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Positions tried in turn while the frame found is too dark to tell episodes apart
+const double FRAME_POSITIONS[] = {0.1, 0.3, 0.5};
+const int DARK_LUMA = 24;
+const QSize DEFAULT_SIZE(320, 180);
+
+QMutex cacheMutex;
+qint64 cacheBytes = -1;
+
+QString cacheDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails";
+}
+
+bool isDark(const QImage &image)
+{
+    const QImage sample = image.scaled(16, 16, Qt::IgnoreAspectRatio, Qt::FastTransformation)
+                              .convertToFormat(QImage::Format_Grayscale8);
+    int sum = 0;
+    for (int y = 0; y < sample.height(); ++y) {
+        const uchar *line = sample.constScanLine(y);
+        for (int x = 0; x < sample.width(); ++x) {
+            sum += line[x];
+        }
+    }
+    return sum < DARK_LUMA * sample.width() * sample.height();
+}
+
+bool isVideo(const QString &source)
+{
+    static const QStringList extensions = {".mp4", ".avi", ".mov", ".mkv", ".webm", ".wmv", ".m4v", ".flv"};
+    const QString lower = source.toLower();
+    return std::any_of(extensions.cbegin(), extensions.cend(), [&](const QString &ext) {
+        return lower.endsWith(ext);
+    });
+}
+
+}
+
+ThumbnailProvider::ThumbnailProvider()
+    : m_sequence(0)
+{
+    // Each job runs a full decoder, a few at once is all the disk and CPU take without hurting playback
+    m_pool.setMaxThreadCount(qMin(MAX_DECODERS, qMax(1, QThread::idealThreadCount() - 1)));
+    m_pool.setThreadPriority(QThread::LowPriority);
+}
+
+ThumbnailProvider::~ThumbnailProvider()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+QQuickImageResponse *ThumbnailProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    const QSize size = requestedSize.isValid() && !requestedSize.isEmpty() ? requestedSize : DEFAULT_SIZE;
+
+    // Later requests come from what is on screen now, they go first
+    return new ThumbnailResponse(&m_pool, QUrl::fromPercentEncoding(id.toUtf8()), size, ++m_sequence);
+}
+
+ThumbnailResponse::ThumbnailResponse(QThreadPool *pool, const QString &source, const QSize &size, int priority)
+    : m_pool(pool), m_job(nullptr), m_state(std::make_shared<ThumbnailState>())
+{
+    // Cache hits are read right here on the image loader thread, the pool is only for decoding
+    if (ThumbnailJob::loadCached(ThumbnailJob::cachePath(source, size), m_image)) {
+        QMetaObject::invokeMethod(this, &ThumbnailResponse::finished, Qt::QueuedConnection);
+        return;
+    }
+
+    m_job = new ThumbnailJob(source, size, m_state);
+    connect(m_job, &ThumbnailJob::done, this, &ThumbnailResponse::onDone);
+    m_pool->start(m_job, priority);
+}
+
+QQuickTextureFactory *ThumbnailResponse::textureFactory() const
+{
+    return QQuickTextureFactory::textureFactoryForImage(m_image);
+}
+
+void ThumbnailResponse::cancel()
+{
+    m_state->cancelled.store(true);
+
+    // Still queued: it never starts, a running one notices the flag
+    if (m_job && !m_state->started.load() && m_pool->tryTake(m_job)) {
+        delete m_job;
+    }
+    m_job = nullptr;
+
+    emit finished();
+}
+
+void ThumbnailResponse::onDone(const QImage &image)
+{
+    if (m_state->cancelled.load()) {
+        return;
+    }
+
+    m_job = nullptr;
+    m_image = image;
+    emit finished();
+}
+
+ThumbnailJob::ThumbnailJob(const QString &source, const QSize &size, std::shared_ptr<ThumbnailState> state)
+    : m_source(source), m_size(size), m_state(std::move(state))
+{
+}
+
+void ThumbnailJob::run()
+{
+    m_state->started.store(true);
+    if (m_state->cancelled.load()) {
+        return;
+    }
+
+    bool conclusive = false;
+    QImage image = extract(conclusive);
+    if (m_state->cancelled.load()) {
+        return;
+    }
+
+    if (!image.isNull()) {
+        image = image.scaled(m_size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    // A timeout or a passing error is tried again next time, only a file with nothing to show is remembered empty
+    if (!image.isNull() || conclusive) {
+        store(cachePath(m_source, m_size), image);
+    }
+    emit done(image);
+}
+
+bool ThumbnailJob::loadCached(const QString &path, QImage &image)
+{
+    // Opened for writing too, the modification time of a read-only handle can not be set on Windows
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite) && !file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // An empty file records that there is nothing to show
+    if (file.size() > 0) {
+        image.loadFromData(file.readAll(), "JPG");
+    }
+
+    // The cache is trimmed by modification time, a hit makes the entry recent again
+    if (!file.isWritable() || !file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime)) {
+        qWarning() << "Could not refresh thumbnail cache entry:" << path << file.errorString();
+    }
+    return true;
+}
+
+QImage ThumbnailJob::extract(bool &conclusive) const
+{
+    conclusive = false;
+    const bool video = isVideo(m_source);
+    QImage result;
+    int attempt = 0;
+    bool seeking = false;
+    qint64 target = 0;
+
+    QMediaPlayer player;
+    QVideoSink sink;
+    QEventLoop loop;
+    QTimer timeout;
+    QTimer cancelCheck;
+
+    // Archive members are read through a device, like the player does
+    std::unique_ptr<ArchiveMemberDevice> device;
+    QString archivePath;
+    QString memberName;
+    const QUrl url = m_source.startsWith("file://") ? QUrl(m_source) : QUrl::fromLocalFile(m_source);
+    if (ArchiveIndex::splitMemberUrl(url, archivePath, memberName)) {
+        ArchiveMember member;
+        if (!ArchiveIndex::findMember(archivePath, memberName, member)) {
+            return QImage();
+        }
+        device = std::make_unique<ArchiveMemberDevice>(archivePath, member);
+        if (!device->open(QIODevice::ReadOnly)) {
+            return QImage();
+        }
+    }
+
+    auto seekNext = [&]() {
+        const qint64 duration = player.duration();
+        target = duration > 0 ? qint64(duration * FRAME_POSITIONS[attempt]) : 0;
+        seeking = true;
+        player.setPosition(target);
+    };
+
+    QObject::connect(&player, &QMediaPlayer::mediaStatusChanged, &loop, [&](QMediaPlayer::MediaStatus status) {
+        if (status == QMediaPlayer::InvalidMedia) {
+            loop.quit();
+        } else if (status == QMediaPlayer::LoadedMedia && !seeking) {
+            if (!video) {
+                const QMediaMetaData metaData = player.metaData();
+                result = metaData.value(QMediaMetaData::CoverArtImage).value<QImage>();
+                if (result.isNull()) {
+                    result = metaData.value(QMediaMetaData::ThumbnailImage).value<QImage>();
+                }
+                conclusive = true;
+                loop.quit();
+                return;
+            }
+            seekNext();
+            player.pause();
+        }
+    });
+
+    QObject::connect(&sink, &QVideoSink::videoFrameChanged, &loop, [&](const QVideoFrame &frame) {
+        if (!seeking || !frame.isValid() || (frame.startTime() >= 0 && frame.startTime() / 1000 < target - 1000)) {
+            return;
+        }
+
+        QImage image = frame.toImage();
+        if (image.isNull()) {
+            return;
+        }
+        result = image;
+
+        if (isDark(image) && ++attempt < int(std::size(FRAME_POSITIONS))) {
+            seekNext();
+            return;
+        }
+        loop.quit();
+    });
+
+    QObject::connect(&player, &QMediaPlayer::errorOccurred, &loop, &QEventLoop::quit);
+
+    timeout.setSingleShot(true);
+    QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+    QObject::connect(&cancelCheck, &QTimer::timeout, &loop, [&]() {
+        if (m_state->cancelled.load()) {
+            loop.quit();
+        }
+    });
+
+    if (video) {
+        player.setVideoSink(&sink);
+    }
+    if (device) {
+        player.setSourceDevice(device.get(), url);
+    } else {
+        player.setSource(url);
+    }
+
+    timeout.start(EXTRACT_TIMEOUT_MS);
+    cancelCheck.start(100);
+    loop.exec();
+
+    // The error signal can quit the loop before the status change that follows it
+    if (player.mediaStatus() == QMediaPlayer::InvalidMedia) {
+        conclusive = true;
+    }
+
+    player.stop();
+    return result;
+}
+
+QString ThumbnailJob::cachePath(const QString &source, const QSize &size)
+{
+    // Archive members change with their archive
+    QString archivePath;
+    QString memberName;
+    const QUrl url = source.startsWith("file://") ? QUrl(source) : QUrl::fromLocalFile(source);
+    const QFileInfo info(ArchiveIndex::splitMemberUrl(url, archivePath, memberName) ? archivePath : url.toLocalFile());
+
+    const QString key = url.toString() + '|' + QString::number(info.size()) + '|' +
+                        QString::number(info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch()) + '|' +
+                        QString::number(size.width()) + 'x' + QString::number(size.height());
+    const QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return cacheDirectory() + '/' + QString::fromLatin1(hash) + ".jpg";
+}
+
+void ThumbnailJob::store(const QString &path, const QImage &image)
+{
+    QDir().mkpath(cacheDirectory());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    if (!image.isNull()) {
+        image.save(&file, "JPG", 85);
+    }
+    if (!file.commit()) {
+        return;
+    }
+
+    QMutexLocker locker(&cacheMutex);
+
+    QDir directory(cacheDirectory());
+    if (cacheBytes < 0) {
+        cacheBytes = 0;
+        for (const QFileInfo &entry : directory.entryInfoList(QDir::Files)) {
+            cacheBytes += entry.size();
+        }
+    } else {
+        cacheBytes += QFileInfo(path).size();
+    }
+
+    if (cacheBytes <= CACHE_LIMIT) {
+        return;
+    }
+
+    // Hits refresh the modification time, so the least recently shown go first
+    const QFileInfoList entries = directory.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+    for (const QFileInfo &entry : entries) {
+        if (cacheBytes <= CACHE_LIMIT * 3 / 4) {
+            break;
+        }
+        if (QFile::remove(entry.absoluteFilePath())) {
+            cacheBytes -= entry.size();
+        }
+    }
+}
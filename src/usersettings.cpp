@@ -0,0 +1,364 @@
+#include "usersettings.h"
+#include "archivereader.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+#include <QUrl>
+#include <utility>
+
+namespace {
+
+const char *const ORGANIZATION = "Odizinne";
+const char *const APPLICATION = "MediaPlayer";
+const char *const FOLDER_PROFILES_KEY = "folderProfiles";
+
+}
+
+UserSettings* UserSettings::s_instance = nullptr;
+
+bool UserSettings::FolderProfile::isEmpty() const
+{
+    return audioLanguage.isEmpty() && subtitleLanguage.isEmpty() && autoSelectSubtitles < 0 && volume < 0;
+}
+
+QVariantMap UserSettings::FolderProfile::toMap() const
+{
+    QVariantMap map;
+    if (!audioLanguage.isEmpty()) {
+        map["audioLanguage"] = audioLanguage;
+    }
+    if (!subtitleLanguage.isEmpty()) {
+        map["subtitleLanguage"] = subtitleLanguage;
+    }
+    if (autoSelectSubtitles >= 0) {
+        map["autoSelectSubtitles"] = autoSelectSubtitles == 1;
+    }
+    if (volume >= 0) {
+        map["volume"] = volume;
+    }
+    return map;
+}
+
+UserSettings::FolderProfile UserSettings::FolderProfile::fromMap(const QVariantMap &map)
+{
+    FolderProfile profile;
+    profile.audioLanguage = map.value("audioLanguage").toString();
+    profile.subtitleLanguage = map.value("subtitleLanguage").toString();
+    if (map.contains("autoSelectSubtitles")) {
+        profile.autoSelectSubtitles = map.value("autoSelectSubtitles").toBool() ? 1 : 0;
+    }
+    profile.volume = map.value("volume", -1).toDouble();
+    return profile;
+}
+
+UserSettings::UserSettings(QObject *parent)
+    : QObject(parent), m_autoSelectSubtitles(true), m_uiOpacity(1), m_floatingUi(true), m_shuffle(false),
+    m_repeatMode(0), m_playlistSortOrder(0), m_readAheadMode(0), m_cropBlackBars(true),
+    m_detectEpisodeMarkers(false), m_skipCredits(false), m_frameCacheSize(256)
+{
+    m_pool.setMaxThreadCount(1);
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &UserSettings::save);
+
+    // The resolved track settings follow both the folder profile and the global preferences
+    connect(this, &UserSettings::folderProfileChanged, this, &UserSettings::resolvedProfileChanged);
+    connect(this, &UserSettings::preferredAudioLanguageChanged, this, &UserSettings::resolvedProfileChanged);
+    connect(this, &UserSettings::preferredSubtitleLanguageChanged, this, &UserSettings::resolvedProfileChanged);
+    connect(this, &UserSettings::autoSelectSubtitlesChanged, this, &UserSettings::resolvedProfileChanged);
+
+    load();
+}
+
+UserSettings::~UserSettings()
+{
+    m_saveTimer.stop();
+    m_pool.waitForDone();
+
+    // Nothing may be left behind on exit, the last changes are written here
+    if (!m_pending.isEmpty()) {
+        write(m_pending);
+    }
+
+    if (s_instance == this) {
+        s_instance = nullptr;
+    }
+}
+
+UserSettings* UserSettings::create(QQmlEngine *qmlEngine, QJSEngine *jsEngine)
+{
+    Q_UNUSED(qmlEngine);
+    Q_UNUSED(jsEngine);
+
+    return instance();
+}
+
+UserSettings* UserSettings::instance()
+{
+    if (!s_instance) {
+        s_instance = new UserSettings();
+    }
+    return s_instance;
+}
+
+void UserSettings::load()
+{
+    // Same keys the QML Settings object used, so existing preferences carry over
+    QSettings settings(ORGANIZATION, APPLICATION);
+    m_preferredAudioLanguage = settings.value("preferredAudioLanguage", "en").toString();
+    m_preferredSubtitleLanguage = settings.value("preferredSubtitleLanguage", "en").toString();
+    m_autoSelectSubtitles = settings.value("autoSelectSubtitles", m_autoSelectSubtitles).toBool();
+    m_uiOpacity = settings.value("uiOpacity", m_uiOpacity).toDouble();
+    m_floatingUi = settings.value("floatingUi", m_floatingUi).toBool();
+    m_shuffle = settings.value("shuffle", m_shuffle).toBool();
+    m_repeatMode = settings.value("repeatMode", m_repeatMode).toInt();
+    m_playlistSortOrder = settings.value("playlistSortOrder", m_playlistSortOrder).toInt();
+    m_readAheadMode = settings.value("readAheadMode", m_readAheadMode).toInt();
+    m_cropBlackBars = settings.value("cropBlackBars", m_cropBlackBars).toBool();
+    m_detectEpisodeMarkers = settings.value("detectEpisodeMarkers", m_detectEpisodeMarkers).toBool();
+    m_skipCredits = settings.value("skipCredits", m_skipCredits).toBool();
+    m_frameCacheSize = settings.value("frameCacheSize", m_frameCacheSize).toInt();
+
+    const QVariantMap profiles = settings.value(FOLDER_PROFILES_KEY).toMap();
+    m_folderProfiles.reserve(profiles.size());
+    for (auto it = profiles.cbegin(); it != profiles.cend(); ++it) {
+        const FolderProfile profile = FolderProfile::fromMap(it.value().toMap());
+        if (!profile.isEmpty()) {
+            m_folderProfiles.insert(it.key(), profile);
+        }
+    }
+}
+
+void UserSettings::save()
+{
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    const QVariantHash values = std::exchange(m_pending, QVariantHash());
+    m_pool.start([values]() {
+        write(values);
+    });
+}
+
+void UserSettings::write(const QVariantHash &values)
+{
+    QSettings settings(ORGANIZATION, APPLICATION);
+    for (auto it = values.cbegin(); it != values.cend(); ++it) {
+        settings.setValue(it.key(), it.value());
+    }
+    settings.sync();
+}
+
+template<typename T>
+bool UserSettings::update(T &member, const T &value, const char *key)
+{
+    if (member == value) {
+        return false;
+    }
+
+    member = value;
+    m_pending.insert(QString::fromLatin1(key), QVariant::fromValue(value));
+    m_saveTimer.start();
+    return true;
+}
+
+void UserSettings::setPreferredAudioLanguage(const QString &language)
+{
+    if (update(m_preferredAudioLanguage, language, "preferredAudioLanguage")) {
+        emit preferredAudioLanguageChanged();
+    }
+}
+
+void UserSettings::setPreferredSubtitleLanguage(const QString &language)
+{
+    if (update(m_preferredSubtitleLanguage, language, "preferredSubtitleLanguage")) {
+        emit preferredSubtitleLanguageChanged();
+    }
+}
+
+void UserSettings::setAutoSelectSubtitles(bool enabled)
+{
+    if (update(m_autoSelectSubtitles, enabled, "autoSelectSubtitles")) {
+        emit autoSelectSubtitlesChanged();
+    }
+}
+
+void UserSettings::setUiOpacity(qreal opacity)
+{
+    if (update(m_uiOpacity, opacity, "uiOpacity")) {
+        emit uiOpacityChanged();
+    }
+}
+
+void UserSettings::setFloatingUi(bool enabled)
+{
+    if (update(m_floatingUi, enabled, "floatingUi")) {
+        emit floatingUiChanged();
+    }
+}
+
+void UserSettings::setShuffle(bool enabled)
+{
+    if (update(m_shuffle, enabled, "shuffle")) {
+        emit shuffleChanged();
+    }
+}
+
+void UserSettings::setRepeatMode(int mode)
+{
+    if (update(m_repeatMode, mode, "repeatMode")) {
+        emit repeatModeChanged();
+    }
+}
+
+void UserSettings::setPlaylistSortOrder(int order)
+{
+    if (update(m_playlistSortOrder, order, "playlistSortOrder")) {
+        emit playlistSortOrderChanged();
+    }
+}
+
+void UserSettings::setReadAheadMode(int mode)
+{
+    if (update(m_readAheadMode, mode, "readAheadMode")) {
+        emit readAheadModeChanged();
+    }
+}
+
+void UserSettings::setCropBlackBars(bool enabled)
+{
+    if (update(m_cropBlackBars, enabled, "cropBlackBars")) {
+        emit cropBlackBarsChanged();
+    }
+}
+
+void UserSettings::setDetectEpisodeMarkers(bool enabled)
+{
+    if (update(m_detectEpisodeMarkers, enabled, "detectEpisodeMarkers")) {
+        emit detectEpisodeMarkersChanged();
+    }
+}
+
+void UserSettings::setSkipCredits(bool enabled)
+{
+    if (update(m_skipCredits, enabled, "skipCredits")) {
+        emit skipCreditsChanged();
+    }
+}
+
+void UserSettings::setFrameCacheSize(int megabytes)
+{
+    if (update(m_frameCacheSize, megabytes, "frameCacheSize")) {
+        emit frameCacheSizeChanged();
+    }
+}
+
+void UserSettings::resetPreferences()
+{
+    setPreferredAudioLanguage("en");
+    setPreferredSubtitleLanguage("en");
+    setAutoSelectSubtitles(true);
+}
+
+void UserSettings::setCurrentFile(const QString &filePath)
+{
+    const QString folder = folderKey(filePath);
+    if (m_currentFolder == folder) {
+        return;
+    }
+
+    const bool hadProfile = hasFolderProfile();
+    m_currentFolder = folder;
+    if (hadProfile || hasFolderProfile()) {
+        emit folderProfileChanged();
+    }
+}
+
+UserSettings::FolderProfile UserSettings::resolvedProfile() const
+{
+    FolderProfile profile = m_folderProfiles.value(m_currentFolder);
+    if (profile.audioLanguage.isEmpty()) {
+        profile.audioLanguage = m_preferredAudioLanguage;
+    }
+    if (profile.subtitleLanguage.isEmpty()) {
+        profile.subtitleLanguage = m_preferredSubtitleLanguage;
+    }
+    if (profile.autoSelectSubtitles < 0) {
+        profile.autoSelectSubtitles = m_autoSelectSubtitles ? 1 : 0;
+    }
+    return profile;
+}
+
+void UserSettings::rememberFolderTracks(const QString &audioLanguage, const QString &subtitleLanguage, bool subtitlesOn)
+{
+    if (m_currentFolder.isEmpty()) {
+        return;
+    }
+
+    FolderProfile profile = m_folderProfiles.value(m_currentFolder);
+    profile.audioLanguage = audioLanguage;
+    profile.subtitleLanguage = subtitleLanguage;
+    profile.autoSelectSubtitles = subtitlesOn ? 1 : 0;
+    updateFolderProfile(profile);
+}
+
+void UserSettings::rememberFolderVolume(qreal volume)
+{
+    if (m_currentFolder.isEmpty()) {
+        return;
+    }
+
+    FolderProfile profile = m_folderProfiles.value(m_currentFolder);
+    profile.volume = qBound(0.0, volume, 1.0);
+    updateFolderProfile(profile);
+}
+
+void UserSettings::forgetFolderProfile()
+{
+    updateFolderProfile(FolderProfile());
+}
+
+void UserSettings::updateFolderProfile(const FolderProfile &profile)
+{
+    if (m_currentFolder.isEmpty()) {
+        return;
+    }
+
+    if (profile.isEmpty()) {
+        if (!m_folderProfiles.remove(m_currentFolder)) {
+            return;
+        }
+    } else {
+        m_folderProfiles.insert(m_currentFolder, profile);
+    }
+
+    QVariantMap profiles;
+    for (auto it = m_folderProfiles.cbegin(); it != m_folderProfiles.cend(); ++it) {
+        profiles.insert(it.key(), it.value().toMap());
+    }
+    m_pending.insert(FOLDER_PROFILES_KEY, profiles);
+    m_saveTimer.start();
+
+    emit folderProfileChanged();
+}
+
+QString UserSettings::folderKey(const QString &filePath)
+{
+    if (filePath.isEmpty()) {
+        return QString();
+    }
+
+    const QUrl url = filePath.startsWith("file://") ? QUrl(filePath) : QUrl::fromLocalFile(filePath);
+
+    // Episodes packed in one archive share its profile, like files in a folder
+    QString archivePath;
+    QString memberName;
+    const QString folder = ArchiveIndex::splitMemberUrl(url, archivePath, memberName)
+                               ? QFileInfo(archivePath).absoluteFilePath()
+                               : QFileInfo(url.toLocalFile()).absolutePath();
+
+    // Paths are case insensitive on Windows
+    return QDir::cleanPath(folder).toLower();
+}
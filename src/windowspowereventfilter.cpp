@@ -1,9 +1,12 @@
 #include "windowspowereventfilter.h"
-#include <Windows.h>
 #include <QGuiApplication>
 #include <QTimer>
 #include <QDebug>
 
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#endif
+
 WindowsPowerEventFilter::WindowsPowerEventFilter(QObject *parent)
     : QObject(parent), m_installed(false)
 {
@@ -24,6 +27,7 @@ bool WindowsPowerEventFilter::nativeEventFilter(const QByteArray &eventType, voi
 {
     Q_UNUSED(result)
 
+#ifdef Q_OS_WIN
     if (eventType == "windows_generic_MSG") {
         MSG *msg = static_cast<MSG*>(message);
 
@@ -43,6 +47,11 @@ bool WindowsPowerEventFilter::nativeEventFilter(const QByteArray &eventType, voi
             }
         }
     }
+#else
+    // Other platforms deliver no power messages here, the filter never fires
+    Q_UNUSED(eventType)
+    Q_UNUSED(message)
+#endif
 
     return false;
 }
@@ -0,0 +1,370 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Writes a short test clip, the container follows the extension: make_fixtures <output> <duration ms>
+//   .wav  mono 16-bit PCM with a 440 Hz tone
+//   .mp4  the same tone as 'sowt' PCM next to uncompressed 'raw ' RGB video
+//   .mkv  the same tone as A_PCM/INT/LIT next to uncompressed V_MS/VFW/FOURCC RGB video
+// Nothing is encoded, so no codec library is needed to generate them. Audio and video are
+// interleaved in steps of one video frame, the duration is rounded down to whole steps.
+
+namespace {
+
+const int SAMPLE_RATE = 44100;
+const int FRAME_RATE = 10;
+const int SAMPLES_PER_FRAME = SAMPLE_RATE / FRAME_RATE;
+const int VIDEO_WIDTH = 64;
+const int VIDEO_HEIGHT = 48;
+const int VIDEO_FRAME_BYTES = VIDEO_WIDTH * VIDEO_HEIGHT * 3;
+
+void putLe(std::string &out, std::uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) {
+        out += char((value >> (8 * i)) & 0xff);
+    }
+}
+
+void putBe(std::string &out, std::uint64_t value, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; --i) {
+        out += char((value >> (8 * i)) & 0xff);
+    }
+}
+
+std::string tone(std::uint32_t firstSample, std::uint32_t count)
+{
+    std::string samples;
+    samples.reserve(count * 2);
+    for (std::uint32_t i = firstSample; i < firstSample + count; ++i) {
+        const double sample = 0.25 * std::sin(2.0 * 3.14159265358979323846 * 440.0 * i / SAMPLE_RATE);
+        putLe(samples, std::uint16_t(std::int16_t(std::lround(sample * 32767))), 2);
+    }
+    return samples;
+}
+
+// A gradient that moves every frame, so consecutive frames differ
+std::string videoFrame(std::uint32_t index)
+{
+    std::string pixels(VIDEO_FRAME_BYTES, '\0');
+    for (int y = 0; y < VIDEO_HEIGHT; ++y) {
+        for (int x = 0; x < VIDEO_WIDTH; ++x) {
+            char *pixel = &pixels[(y * VIDEO_WIDTH + x) * 3];
+            pixel[0] = char((x * 4 + index * 16) & 0xff);
+            pixel[1] = char((y * 5) & 0xff);
+            pixel[2] = char((index * 32) & 0xff);
+        }
+    }
+    return pixels;
+}
+
+std::string wav(std::uint32_t frames)
+{
+    const std::uint32_t dataBytes = frames * 2;
+
+    std::string out = "RIFF";
+    putLe(out, 36 + dataBytes, 4);
+    out += "WAVEfmt ";
+    putLe(out, 16, 4);
+    putLe(out, 1, 2);
+    putLe(out, 1, 2);
+    putLe(out, SAMPLE_RATE, 4);
+    putLe(out, SAMPLE_RATE * 2, 4);
+    putLe(out, 2, 2);
+    putLe(out, 16, 2);
+    out += "data";
+    putLe(out, dataBytes, 4);
+    out += tone(0, frames);
+    return out;
+}
+
+std::string box(const char *type, const std::string &payload)
+{
+    std::string out;
+    putBe(out, 8 + payload.size(), 4);
+    out += type;
+    return out + payload;
+}
+
+std::string fullBox(const char *type, std::uint32_t flags, const std::string &payload)
+{
+    std::string versionAndFlags;
+    putBe(versionAndFlags, flags, 4);
+    return box(type, versionAndFlags + payload);
+}
+
+std::string matrix()
+{
+    std::string out;
+    for (std::uint32_t value : {0x00010000u, 0u, 0u, 0u, 0x00010000u, 0u, 0u, 0u, 0x40000000u}) {
+        putBe(out, value, 4);
+    }
+    return out;
+}
+
+std::string sampleTable(const std::string &sampleEntry, std::uint32_t samples, std::uint32_t samplesPerChunk,
+                        std::uint32_t sampleSize, const std::string &chunkOffsets, std::uint32_t chunks)
+{
+    std::string stsd;
+    putBe(stsd, 1, 4);
+    stsd += sampleEntry;
+
+    std::string stts;
+    putBe(stts, 1, 4);
+    putBe(stts, samples, 4);
+    putBe(stts, 1, 4);
+
+    std::string stsc;
+    putBe(stsc, 1, 4);
+    putBe(stsc, 1, 4);
+    putBe(stsc, samplesPerChunk, 4);
+    putBe(stsc, 1, 4);
+
+    std::string stsz;
+    putBe(stsz, sampleSize, 4);
+    putBe(stsz, samples, 4);
+
+    std::string stco;
+    putBe(stco, chunks, 4);
+    stco += chunkOffsets;
+
+    return box("stbl", fullBox("stsd", 0, stsd) + fullBox("stts", 0, stts) + fullBox("stsc", 0, stsc) +
+                           fullBox("stsz", 0, stsz) + fullBox("stco", 0, stco));
+}
+
+std::string track(std::uint32_t id, std::uint32_t durationMs, bool video, std::uint32_t timescale,
+                  std::uint32_t mediaDuration, const std::string &mediaHeader, const std::string &stbl)
+{
+    std::string tkhd;
+    putBe(tkhd, 0, 8);
+    putBe(tkhd, id, 4);
+    putBe(tkhd, 0, 4);
+    putBe(tkhd, durationMs, 4);
+    putBe(tkhd, 0, 8);
+    putBe(tkhd, 0, 4);
+    putBe(tkhd, video ? 0 : 0x0100, 2);
+    putBe(tkhd, 0, 2);
+    tkhd += matrix();
+    putBe(tkhd, video ? VIDEO_WIDTH << 16 : 0, 4);
+    putBe(tkhd, video ? VIDEO_HEIGHT << 16 : 0, 4);
+
+    std::string mdhd;
+    putBe(mdhd, 0, 8);
+    putBe(mdhd, timescale, 4);
+    putBe(mdhd, mediaDuration, 4);
+    putBe(mdhd, 0x55c4, 2); // und
+    putBe(mdhd, 0, 2);
+
+    std::string hdlr;
+    putBe(hdlr, 0, 4);
+    hdlr += video ? "vide" : "soun";
+    putBe(hdlr, 0, 12);
+    hdlr += video ? "VideoHandler" : "SoundHandler";
+    hdlr += '\0';
+
+    std::string url;
+    putBe(url, 1, 4);
+    url = box("url ", url);
+    std::string dref;
+    putBe(dref, 0, 4);
+    putBe(dref, 1, 4);
+    const std::string dinf = box("dinf", box("dref", dref + url));
+
+    return box("trak", fullBox("tkhd", 3, tkhd) +
+                           box("mdia", fullBox("mdhd", 0, mdhd) + fullBox("hdlr", 0, hdlr) +
+                                           box("minf", mediaHeader + dinf + stbl)));
+}
+
+std::string mp4(std::uint32_t steps)
+{
+    const std::uint32_t durationMs = steps * 1000 / FRAME_RATE;
+
+    std::string ftyp = "isom";
+    putBe(ftyp, 512, 4);
+    ftyp += "isommp41";
+    ftyp = box("ftyp", ftyp);
+
+    std::string media;
+    std::string videoOffsets;
+    std::string audioOffsets;
+    const std::uint64_t mediaStart = ftyp.size() + 8;
+    for (std::uint32_t step = 0; step < steps; ++step) {
+        putBe(videoOffsets, mediaStart + media.size(), 4);
+        media += videoFrame(step);
+        putBe(audioOffsets, mediaStart + media.size(), 4);
+        media += tone(step * SAMPLES_PER_FRAME, SAMPLES_PER_FRAME);
+    }
+
+    std::string mvhd;
+    putBe(mvhd, 0, 8);
+    putBe(mvhd, 1000, 4);
+    putBe(mvhd, durationMs, 4);
+    putBe(mvhd, 0x00010000, 4);
+    putBe(mvhd, 0x0100, 2);
+    putBe(mvhd, 0, 10);
+    mvhd += matrix();
+    putBe(mvhd, 0, 24);
+    putBe(mvhd, 3, 4);
+
+    // Uncompressed QuickTime video, 24-bit RGB
+    std::string rawEntry;
+    putBe(rawEntry, 0, 6);
+    putBe(rawEntry, 1, 2);
+    putBe(rawEntry, 0, 16);
+    putBe(rawEntry, VIDEO_WIDTH, 2);
+    putBe(rawEntry, VIDEO_HEIGHT, 2);
+    putBe(rawEntry, 0x00480000, 4);
+    putBe(rawEntry, 0x00480000, 4);
+    putBe(rawEntry, 0, 4);
+    putBe(rawEntry, 1, 2);
+    rawEntry += std::string(32, '\0');
+    putBe(rawEntry, 24, 2);
+    putBe(rawEntry, 0xffff, 2);
+    rawEntry = box("raw ", rawEntry);
+
+    // Little-endian 16-bit PCM, one sample per PCM frame
+    std::string sowtEntry;
+    putBe(sowtEntry, 0, 6);
+    putBe(sowtEntry, 1, 2);
+    putBe(sowtEntry, 0, 8);
+    putBe(sowtEntry, 1, 2);
+    putBe(sowtEntry, 16, 2);
+    putBe(sowtEntry, 0, 4);
+    putBe(sowtEntry, std::uint32_t(SAMPLE_RATE) << 16, 4);
+    sowtEntry = box("sowt", sowtEntry);
+
+    std::string vmhd;
+    putBe(vmhd, 0, 8);
+    std::string smhd;
+    putBe(smhd, 0, 4);
+
+    const std::string moov = box("moov", fullBox("mvhd", 0, mvhd) +
+        track(1, durationMs, true, FRAME_RATE, steps, fullBox("vmhd", 1, vmhd),
+              sampleTable(rawEntry, steps, 1, VIDEO_FRAME_BYTES, videoOffsets, steps)) +
+        track(2, durationMs, false, SAMPLE_RATE, steps * SAMPLES_PER_FRAME, fullBox("smhd", 0, smhd),
+              sampleTable(sowtEntry, steps * SAMPLES_PER_FRAME, SAMPLES_PER_FRAME, 2, audioOffsets, steps)));
+
+    return ftyp + box("mdat", media) + moov;
+}
+
+// Matroska elements all get an 8-byte size, which every reader accepts
+std::string element(std::uint32_t id, const std::string &payload)
+{
+    std::string out;
+    putBe(out, id, id > 0xffffff ? 4 : id > 0xffff ? 3 : id > 0xff ? 2 : 1);
+    out += char(0x01);
+    putBe(out, payload.size(), 7);
+    return out + payload;
+}
+
+std::string uintElement(std::uint32_t id, std::uint64_t value)
+{
+    std::string payload;
+    putBe(payload, value, 8);
+    return element(id, payload);
+}
+
+std::string floatElement(std::uint32_t id, double value)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    std::string payload;
+    putBe(payload, bits, 8);
+    return element(id, payload);
+}
+
+std::string mkv(std::uint32_t steps)
+{
+    const std::uint32_t durationMs = steps * 1000 / FRAME_RATE;
+
+    const std::string ebml = element(0x1a45dfa3, uintElement(0x4286, 1) + uintElement(0x42f7, 1) +
+                                                     uintElement(0x42f2, 4) + uintElement(0x42f3, 8) +
+                                                     element(0x4282, "matroska") + uintElement(0x4287, 4) +
+                                                     uintElement(0x4285, 2));
+
+    const std::string info = element(0x1549a966, uintElement(0x2ad7b1, 1000000) + floatElement(0x4489, durationMs) +
+                                                     element(0x4d80, "make_fixtures") + element(0x5741, "make_fixtures"));
+
+    // BITMAPINFOHEADER for bottom-up BI_RGB, rows of 64 pixels need no padding
+    std::string bitmapInfo;
+    putLe(bitmapInfo, 40, 4);
+    putLe(bitmapInfo, VIDEO_WIDTH, 4);
+    putLe(bitmapInfo, VIDEO_HEIGHT, 4);
+    putLe(bitmapInfo, 1, 2);
+    putLe(bitmapInfo, 24, 2);
+    putLe(bitmapInfo, 0, 4);
+    putLe(bitmapInfo, VIDEO_FRAME_BYTES, 4);
+    putLe(bitmapInfo, 0, 16);
+
+    const std::string videoTrack = element(0xae, uintElement(0xd7, 1) + uintElement(0x73c5, 1) + uintElement(0x83, 1) +
+                                                     element(0x86, "V_MS/VFW/FOURCC") + element(0x63a2, bitmapInfo) +
+                                                     uintElement(0x23e383, 1000000000 / FRAME_RATE) +
+                                                     element(0xe0, uintElement(0xb0, VIDEO_WIDTH) +
+                                                                       uintElement(0xba, VIDEO_HEIGHT)));
+    const std::string audioTrack = element(0xae, uintElement(0xd7, 2) + uintElement(0x73c5, 2) + uintElement(0x83, 2) +
+                                                     element(0x86, "A_PCM/INT/LIT") +
+                                                     element(0xe1, floatElement(0xb5, SAMPLE_RATE) +
+                                                                       uintElement(0x9f, 1) + uintElement(0x6264, 16)));
+    std::string segment = info + element(0x1654ae6b, videoTrack + audioTrack);
+
+    // One cluster per step, a keyframe SimpleBlock for each track at its start
+    for (std::uint32_t step = 0; step < steps; ++step) {
+        std::string video = "\x81";
+        putBe(video, 0, 2);
+        video += char(0x80);
+        video += videoFrame(step);
+
+        std::string audio = "\x82";
+        putBe(audio, 0, 2);
+        audio += char(0x80);
+        audio += tone(step * SAMPLES_PER_FRAME, SAMPLES_PER_FRAME);
+
+        segment += element(0x1f43b675, uintElement(0xe7, step * 1000 / FRAME_RATE) + element(0xa3, video) +
+                                           element(0xa3, audio));
+    }
+
+    return ebml + element(0x18538067, segment);
+}
+
+bool endsWith(const std::string &text, const std::string &suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        std::cerr << "usage: make_fixtures <output.wav|.mp4|.mkv> <duration ms>\n";
+        return 1;
+    }
+
+    const std::string path = argv[1];
+    const long long durationMs = std::atoll(argv[2]);
+
+    std::string content;
+    if (endsWith(path, ".wav")) {
+        content = wav(std::uint32_t(durationMs * SAMPLE_RATE / 1000));
+    } else if (endsWith(path, ".mp4")) {
+        content = mp4(std::uint32_t(durationMs * FRAME_RATE / 1000));
+    } else if (endsWith(path, ".mkv")) {
+        content = mkv(std::uint32_t(durationMs * FRAME_RATE / 1000));
+    } else {
+        std::cerr << "unknown container: " << path << '\n';
+        return 1;
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "cannot write " << path << '\n';
+        return 1;
+    }
+
+    out.write(content.data(), std::streamsize(content.size()));
+    return out ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+#include <QtTest>
+#include <QAudioOutput>
+#include <QMediaPlayer>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QVideoSink>
+#include "mediacontroller.h"
+#include "usersettings.h"
+#include "singleinstanceserver.h"
+#include "playbackstats.h"
+#include "durationprober.h"
+
+class TestPlaybackSequence : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void fixtureDurations_data();
+    void fixtureDurations();
+    void playlistFromFolder();
+    void autoAdvanceThroughFolder();
+    void manualPlayIsNotTimed();
+    void folderProfileOnLoad();
+    void fileFromAnotherInstance();
+
+private:
+    static QString fixturePath(const QString &fileName);
+    static QString fixtureUrl(const QString &fileName);
+
+    MediaController *m_controller = nullptr;
+
+    static constexpr int FIXTURE_COUNT = 3;
+
+    // Generous, CI machines decode slowly but a stuck transition still fails
+    static constexpr int TRANSITION_TIMEOUT_MS = 5000;
+    static constexpr int PLAYBACK_TIMEOUT_MS = FIXTURE_DURATION_MS * FIXTURE_COUNT * 4 + 10000;
+};
+
+/**
+ * Stands in for the window: loads media the way Common.loadMedia does and
+ * reacts to the player the way Main.qml does, so what plays next is decided
+ * by MediaController alone
+ */
+class PlaybackDriver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PlaybackDriver(MediaController *controller)
+        : m_controller(controller)
+    {
+        m_audioOutput.setVolume(0);
+        m_player.setAudioOutput(&m_audioOutput);
+        m_player.setVideoSink(&m_videoSink);
+        m_stats.setPlayer(&m_player);
+        m_stats.setVideoSink(&m_videoSink);
+        m_controller->setPlaybackStats(&m_stats);
+
+        connect(&m_player, &QMediaPlayer::mediaStatusChanged, this, &PlaybackDriver::onMediaStatusChanged);
+        connect(&m_player, &QMediaPlayer::tracksChanged, this, [this]() {
+            m_controller->updateTracks(toVariantList(m_player.audioTracks()), toVariantList(m_player.subtitleTracks()),
+                                       m_player.activeAudioTrack(), m_player.activeSubtitleTrack());
+        });
+    }
+
+    ~PlaybackDriver()
+    {
+        m_controller->setPlaybackStats(nullptr);
+    }
+
+    void load(const QString &source)
+    {
+        const QString mediaPath = m_controller->resolveSource(source);
+        m_controller->buildPlaylistFromFile(mediaPath);
+        m_controller->setCurrentFile(mediaPath);
+        m_controller->loadMediaMetadata(mediaPath);
+    }
+
+    void open(const QString &source)
+    {
+        load(source);
+        m_opened << source;
+        m_controller->openSource(&m_player, source);
+    }
+
+    // Outputs first, so the player goes before them
+    QAudioOutput m_audioOutput;
+    QVideoSink m_videoSink;
+    QMediaPlayer m_player;
+    PlaybackStats m_stats;
+    QStringList m_opened;
+    QStringList m_events;
+    bool m_autoAdvance = true;
+    int m_reopenDelayMs = 0;
+
+private:
+    static QVariantList toVariantList(const QList<QMediaMetaData> &tracks)
+    {
+        QVariantList list;
+        for (const QMediaMetaData &track : tracks) {
+            list.append(QVariant::fromValue(track));
+        }
+        return list;
+    }
+
+    void onMediaStatusChanged(QMediaPlayer::MediaStatus status)
+    {
+        // Stopping at the end reports LoadedMedia for the old source again, that is not an open
+        if (status == QMediaPlayer::LoadedMedia && !m_advancing) {
+            m_events << "loaded";
+            m_player.play();
+        } else if (status == QMediaPlayer::EndOfMedia && !m_advancing) {
+            m_events << "end";
+            if (!m_controller->hasNext()) {
+                return;
+            }
+
+            if (m_autoAdvance) {
+                m_stats.markAutoAdvance();
+            }
+
+            // playNext: clear the source and open the next file on a later event loop turn
+            const QString next = m_controller->getNextFile();
+            m_advancing = true;
+            m_player.stop();
+            m_player.setSource(QUrl());
+            QTimer::singleShot(m_reopenDelayMs, this, [this, next]() {
+                m_advancing = false;
+                open(next);
+            });
+        }
+    }
+
+    MediaController *m_controller;
+    bool m_advancing = false;
+};
+
+QString TestPlaybackSequence::fixturePath(const QString &fileName)
+{
+    return QStringLiteral(FIXTURE_DIR) + '/' + fileName;
+}
+
+QString TestPlaybackSequence::fixtureUrl(const QString &fileName)
+{
+    return QUrl::fromLocalFile(fixturePath(fileName)).toString();
+}
+
+void TestPlaybackSequence::initTestCase()
+{
+    // Settings, the duration cache and the quick open index stay out of the user's own
+    QStandardPaths::setTestModeEnabled(true);
+
+    m_controller = MediaController::create(nullptr, nullptr);
+    QVERIFY(m_controller);
+    m_controller->setParent(this);
+}
+
+void TestPlaybackSequence::init()
+{
+    m_controller->setSortOrder(MediaController::SortByName);
+    m_controller->setRepeatMode(MediaController::RepeatOff);
+    m_controller->setShuffle(false);
+}
+
+void TestPlaybackSequence::cleanup()
+{
+    UserSettings *settings = UserSettings::instance();
+    settings->setCurrentFile(fixturePath("tone.wav"));
+    settings->forgetFolderProfile();
+}
+
+void TestPlaybackSequence::fixtureDurations_data()
+{
+    QTest::addColumn<QString>("fileName");
+
+    QTest::newRow("wav") << "tone.wav";
+    QTest::newRow("mp4") << "clip.mp4";
+    QTest::newRow("mkv") << "clip.mkv";
+}
+
+void TestPlaybackSequence::fixtureDurations()
+{
+    QFETCH(QString, fileName);
+
+    const QString path = fixturePath(fileName);
+    QVERIFY2(QFile::exists(path), qPrintable(path));
+
+    // Header parsing agrees with what was generated, give or take an audio frame of padding
+    const qint64 duration = DurationProber::readDuration(path);
+    QVERIFY2(qAbs(duration - FIXTURE_DURATION_MS) <= 100, qPrintable(QString::number(duration)));
+}
+
+void TestPlaybackSequence::playlistFromFolder()
+{
+    PlaybackDriver driver(m_controller);
+    QSignalSpy playlistSpy(m_controller, &MediaController::playlistChanged);
+    QSignalSpy metadataSpy(m_controller, &MediaController::metadataChanged);
+
+    driver.load(fixtureUrl("clip.mp4"));
+
+    QVERIFY(playlistSpy.count() >= 1);
+    QCOMPARE(m_controller->getPlaylist(), QStringList({fixtureUrl("clip.mkv"), fixtureUrl("clip.mp4"), fixtureUrl("tone.wav")}));
+    QCOMPARE(m_controller->getPlaylistSize(), FIXTURE_COUNT);
+    QCOMPARE(m_controller->getCurrentIndex(), 1);
+    QVERIFY(m_controller->hasNext());
+    QVERIFY(m_controller->hasPrevious());
+    QCOMPARE(m_controller->getNextFile(), fixtureUrl("tone.wav"));
+    QCOMPARE(m_controller->getPreviousFile(), fixtureUrl("clip.mkv"));
+
+    // The metadata player loads in the background, without tags the title is the file name
+    QTRY_VERIFY_WITH_TIMEOUT(metadataSpy.count() >= 1, TRANSITION_TIMEOUT_MS);
+    QCOMPARE(m_controller->getCurrentTitle(), QStringLiteral("clip"));
+
+    // Every entry is probed off the GUI thread
+    QTRY_VERIFY_WITH_TIMEOUT(m_controller->playlistDurationComplete(), TRANSITION_TIMEOUT_MS);
+    QVERIFY2(qAbs(m_controller->playlistDuration() - FIXTURE_COUNT * FIXTURE_DURATION_MS) <= FIXTURE_COUNT * 100,
+             qPrintable(QString::number(m_controller->playlistDuration())));
+
+    // The audio-only file is the smallest, the new order arrives with the background rescan
+    m_controller->setSortOrder(MediaController::SortBySize);
+    QTRY_COMPARE_WITH_TIMEOUT(m_controller->getPlaylist().first(), fixtureUrl("tone.wav"), TRANSITION_TIMEOUT_MS);
+    QCOMPARE(m_controller->getPlaylist().at(m_controller->getCurrentIndex()), fixtureUrl("clip.mp4"));
+}
+
+void TestPlaybackSequence::autoAdvanceThroughFolder()
+{
+    PlaybackDriver driver(m_controller);
+    QSignalSpy metadataSpy(m_controller, &MediaController::metadataChanged);
+    QSignalSpy tracksSpy(m_controller, &MediaController::tracksChanged);
+
+    driver.open(fixtureUrl("clip.mkv"));
+
+    // Name order through the folder, with repeat off the last file stays at its end
+    QTRY_COMPARE_WITH_TIMEOUT(driver.m_events.size(), 2 * FIXTURE_COUNT, PLAYBACK_TIMEOUT_MS);
+    QCOMPARE(driver.m_events, QStringList({"loaded", "end", "loaded", "end", "loaded", "end"}));
+    QCOMPARE(driver.m_opened, QStringList({fixtureUrl("clip.mkv"), fixtureUrl("clip.mp4"), fixtureUrl("tone.wav")}));
+    QCOMPARE(m_controller->getCurrentIndex(), FIXTURE_COUNT - 1);
+    QVERIFY(!m_controller->hasNext());
+
+    QTRY_COMPARE_WITH_TIMEOUT(m_controller->getCurrentTitle(), QStringLiteral("tone"), TRANSITION_TIMEOUT_MS);
+    QVERIFY(metadataSpy.count() >= FIXTURE_COUNT);
+
+    // Tracks of the playing file are mirrored, every fixture has a single audio track
+    QVERIFY(tracksSpy.count() >= 1);
+    QCOMPARE(m_controller->getAudioTracks().size(), 1);
+
+    // The advance covers opening the next file, so it can not be shorter than that
+    const PlaybackStats &stats = driver.m_stats;
+    QVERIFY2(stats.openLatencyMs() >= 0 && stats.openLatencyMs() < TRANSITION_TIMEOUT_MS,
+             qPrintable(QString::number(stats.openLatencyMs())));
+    QVERIFY2(stats.advanceLatencyMs() >= stats.openLatencyMs() && stats.advanceLatencyMs() < TRANSITION_TIMEOUT_MS,
+             qPrintable(QString::number(stats.advanceLatencyMs())));
+}
+
+void TestPlaybackSequence::manualPlayIsNotTimed()
+{
+    // Playing on after the end without an automatic advance, as after the continue prompt
+    PlaybackDriver driver(m_controller);
+    driver.m_autoAdvance = false;
+    driver.m_reopenDelayMs = 300;
+    driver.open(fixtureUrl("clip.mp4"));
+
+    QTRY_COMPARE_WITH_TIMEOUT(driver.m_events.size(), 3, PLAYBACK_TIMEOUT_MS);
+    QCOMPARE(driver.m_opened.last(), fixtureUrl("tone.wav"));
+    QTRY_COMPARE_WITH_TIMEOUT(driver.m_player.playbackState(), QMediaPlayer::PlayingState, TRANSITION_TIMEOUT_MS);
+
+    QVERIFY(driver.m_stats.openLatencyMs() >= 0);
+    QCOMPARE(driver.m_stats.advanceLatencyMs(), -1.0);
+}
+
+void TestPlaybackSequence::folderProfileOnLoad()
+{
+    UserSettings *settings = UserSettings::instance();
+    settings->setCurrentFile(fixturePath("tone.wav"));
+    settings->rememberFolderTracks("fra", "eng", true);
+    settings->rememberFolderVolume(0.25);
+
+    // Loading any file of the folder asks for its volume and resolves its tracks
+    PlaybackDriver driver(m_controller);
+    QSignalSpy volumeSpy(m_controller, &MediaController::folderVolumeRequested);
+    driver.load(fixtureUrl("clip.mkv"));
+
+    QCOMPARE(volumeSpy.count(), 1);
+    QCOMPARE(volumeSpy.first().first().toReal(), 0.25);
+    QCOMPARE(settings->resolvedAudioLanguage(), QStringLiteral("fra"));
+    QCOMPARE(settings->resolvedSubtitleLanguage(), QStringLiteral("eng"));
+    QVERIFY(settings->resolvedAutoSelectSubtitles());
+
+    // Without a profile the window keeps its own volume
+    settings->forgetFolderProfile();
+    driver.load(fixtureUrl("clip.mp4"));
+    QCOMPARE(volumeSpy.count(), 2);
+    QVERIFY(volumeSpy.last().first().toReal() < 0);
+    QCOMPARE(settings->resolvedAudioLanguage(), settings->preferredAudioLanguage());
+}
+
+void TestPlaybackSequence::fileFromAnotherInstance()
+{
+    SingleInstanceServer server;
+    QVERIFY(server.startServer());
+    m_controller->setInstanceServer(&server);
+
+    QSignalSpy receivedSpy(m_controller, &MediaController::fileReceivedFromAnotherInstance);
+
+    // A second launch hands its file over and exits
+    SingleInstanceServer secondInstance;
+    QVERIFY(secondInstance.connectToExistingInstance(fixturePath("tone.wav")));
+    QTRY_COMPARE_WITH_TIMEOUT(receivedSpy.count(), 1, TRANSITION_TIMEOUT_MS);
+    QCOMPARE(receivedSpy.first().first().toString(), fixturePath("tone.wav"));
+
+    // Missing files are dropped before they reach the window
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Received file path does not exist"));
+    QVERIFY(secondInstance.connectToExistingInstance(fixturePath("missing.wav")));
+    QTest::qWait(500);
+    QCOMPARE(receivedSpy.count(), 1);
+
+    // The window opens what it received like any other file
+    PlaybackDriver driver(m_controller);
+    driver.open(QUrl::fromLocalFile(receivedSpy.first().first().toString()).toString());
+    QTRY_VERIFY_WITH_TIMEOUT(!driver.m_events.isEmpty(), TRANSITION_TIMEOUT_MS);
+    QCOMPARE(driver.m_events.first(), QStringLiteral("loaded"));
+    QCOMPARE(m_controller->getPlaylist().at(m_controller->getCurrentIndex()), fixtureUrl("tone.wav"));
+
+    m_controller->setInstanceServer(nullptr);
+}
+
+QTEST_MAIN(TestPlaybackSequence)
+#include "tst_playbacksequence.moc"
@@ -0,0 +1,176 @@
+#include <QtTest>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <cstring>
+#include "quickopenindex.h"
+
+class TestQuickOpenIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void loadsInBackground();
+    void keepsEntriesAddedWhileLoading();
+    void rejectsFullHashTable();
+    void benchmarkLoad();
+    void benchmarkSearch();
+
+private:
+    static QString indexPath();
+    static QString episodePath(int show, int episode);
+    static bool waitLoaded(const QuickOpenIndex &index);
+
+    static constexpr int SHOWS = 400;
+    static constexpr int EPISODES = 50;
+    static constexpr int LOAD_TIMEOUT_MS = 10000;
+};
+
+QString TestQuickOpenIndex::indexPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/quickopen.idx";
+}
+
+QString TestQuickOpenIndex::episodePath(int show, int episode)
+{
+    return QStringLiteral("D:/Media/Show %1/Show %1 - Episode %2.mkv").arg(show).arg(episode);
+}
+
+bool TestQuickOpenIndex::waitLoaded(const QuickOpenIndex &index)
+{
+    return QTest::qWaitFor([&index]() { return !index.isLoading(); }, LOAD_TIMEOUT_MS);
+}
+
+void TestQuickOpenIndex::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QFile::remove(indexPath());
+    QFile::remove(indexPath() + ".new");
+
+    // Written out when the index goes away
+    QuickOpenIndex index;
+    for (int show = 0; show < SHOWS; ++show) {
+        QStringList folder;
+        for (int episode = 0; episode < EPISODES; ++episode) {
+            folder << episodePath(show, episode);
+        }
+        index.addFiles(folder);
+    }
+    index.markPlayed(episodePath(7, 3));
+}
+
+void TestQuickOpenIndex::cleanupTestCase()
+{
+    QFile::remove(indexPath());
+    QFile::remove(indexPath() + ".new");
+}
+
+void TestQuickOpenIndex::loadsInBackground()
+{
+    QVERIFY(QFile::exists(indexPath()));
+
+    // The file is only checked on a worker, nothing of it is used before that
+    QuickOpenIndex index;
+    QVERIFY(index.isLoading());
+    QVERIFY(index.search("show 123 episode 45", 1).isEmpty());
+
+    QVERIFY(waitLoaded(index));
+    const QList<QuickOpenIndex::Result> results = index.search("show 123 episode 45", 1);
+    QCOMPARE(results.size(), 1);
+    QCOMPARE(results.first().path, episodePath(123, 45));
+
+    // What was played is listed for an empty query
+    const QList<QuickOpenIndex::Result> played = index.search(QString(), 10);
+    QCOMPARE(played.size(), 1);
+    QCOMPARE(played.first().path, episodePath(7, 3));
+}
+
+void TestQuickOpenIndex::keepsEntriesAddedWhileLoading()
+{
+    const QString added = QStringLiteral("D:/Media/Extras/Behind the Scenes.mkv");
+
+    {
+        QuickOpenIndex index;
+        QVERIFY(index.isLoading());
+        index.addFiles({added, episodePath(12, 4)});
+        index.markPlayed(episodePath(12, 4));
+        QVERIFY(waitLoaded(index));
+
+        // A path that was already in the file is not listed twice
+        QCOMPARE(index.search(QString(), 10).size(), 2);
+        QCOMPARE(index.search("behind scenes", 5).size(), 1);
+    }
+
+    QuickOpenIndex reloaded;
+    QVERIFY(waitLoaded(reloaded));
+    const QList<QuickOpenIndex::Result> results = reloaded.search("behind scenes", 5);
+    QCOMPARE(results.size(), 1);
+    QCOMPARE(results.first().path, added);
+    QCOMPARE(reloaded.search(QString(), 10).size(), 2);
+}
+
+void TestQuickOpenIndex::rejectsFullHashTable()
+{
+    QFile file(indexPath());
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray original = file.readAll();
+    file.close();
+
+    // Header: magic, version, path count, trigram count, hash slots, string bytes
+    quint32 header[6];
+    memcpy(header, original.constData(), sizeof(header));
+    const qsizetype postingOffsetsEnd = 6 + qsizetype(header[2]) * 2 + 1 + qsizetype(header[3]) * 2 + 1;
+    quint32 postingCount;
+    memcpy(&postingCount, original.constData() + (postingOffsetsEnd - 1) * 4, 4);
+    const qsizetype slotsBegin = (postingOffsetsEnd + postingCount) * 4;
+
+    // Every slot taken, a lookup of a missing path would never reach an empty one
+    QByteArray corrupted = original;
+    for (quint32 slot = 0; slot < header[4]; ++slot) {
+        quint32 value;
+        memcpy(&value, corrupted.constData() + slotsBegin + slot * 4, 4);
+        if (value == 0) {
+            value = 1;
+            memcpy(corrupted.data() + slotsBegin + slot * 4, &value, 4);
+        }
+    }
+
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(corrupted), qint64(corrupted.size()));
+    file.close();
+
+    {
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Ignoring invalid quick open index"));
+        QuickOpenIndex index;
+        QVERIFY(waitLoaded(index));
+        QVERIFY(index.search("show 123 episode 45", 1).isEmpty());
+    }
+
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(original), qint64(original.size()));
+    file.close();
+}
+
+void TestQuickOpenIndex::benchmarkLoad()
+{
+    // Mapping plus the check on the worker, the constructor itself returns before the check
+    QBENCHMARK {
+        QuickOpenIndex index;
+        QVERIFY(waitLoaded(index));
+    }
+}
+
+void TestQuickOpenIndex::benchmarkSearch()
+{
+    QuickOpenIndex index;
+    QVERIFY(waitLoaded(index));
+
+    QBENCHMARK {
+        index.search("show 123 episode 45", 50);
+    }
+}
+
+QTEST_MAIN(TestQuickOpenIndex)
+#include "tst_quickopenindex.moc"
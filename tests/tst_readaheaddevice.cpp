@@ -0,0 +1,150 @@
+#include <QtTest>
+#include <QTemporaryFile>
+#include "readaheaddevice.h"
+#include "latencyfiledevice.h"
+
+class TestReadAheadDevice : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void sequentialReadsMatchFile();
+    void seekOutsideWindowRefills();
+    void shortReadsAtEnd();
+    void stallsAreCounted();
+
+private:
+    ReadAheadDevice *openDevice(int latencyMs);
+
+    // Larger than the ring so a far seek has to restart prefetching
+    static constexpr qint64 FILE_SIZE = 24 * 1024 * 1024 + 123;
+
+    QTemporaryFile m_file;
+    QByteArray m_content;
+};
+
+void TestReadAheadDevice::initTestCase()
+{
+    m_content.resize(FILE_SIZE);
+    quint32 state = 0x12345678;
+    for (qint64 i = 0; i < FILE_SIZE; ++i) {
+        state = state * 1664525u + 1013904223u;
+        m_content[i] = char(state >> 24);
+    }
+
+    QVERIFY(m_file.open());
+    QCOMPARE(m_file.write(m_content), FILE_SIZE);
+    QVERIFY(m_file.flush());
+}
+
+ReadAheadDevice *TestReadAheadDevice::openDevice(int latencyMs)
+{
+    auto *upstream = new LatencyFileDevice(m_file.fileName(), latencyMs);
+    if (!upstream->open(QIODevice::ReadOnly)) {
+        delete upstream;
+        return nullptr;
+    }
+
+    auto *device = new ReadAheadDevice(upstream);
+    if (!device->open(QIODevice::ReadOnly)) {
+        delete device;
+        return nullptr;
+    }
+    return device;
+}
+
+void TestReadAheadDevice::sequentialReadsMatchFile()
+{
+    std::unique_ptr<ReadAheadDevice> device(openDevice(0));
+    QVERIFY(device);
+    QCOMPARE(device->size(), FILE_SIZE);
+
+    // Odd sized reads so they straddle chunk and ring boundaries
+    QByteArray result;
+    result.reserve(FILE_SIZE);
+    while (!device->atEnd()) {
+        const QByteArray part = device->read(65537);
+        QVERIFY(!part.isEmpty());
+        result += part;
+    }
+
+    QCOMPARE(qint64(result.size()), FILE_SIZE);
+    QVERIFY(result == m_content);
+    QCOMPARE(device->bytesFetched(), FILE_SIZE);
+}
+
+void TestReadAheadDevice::seekOutsideWindowRefills()
+{
+    std::unique_ptr<ReadAheadDevice> device(openDevice(0));
+    QVERIFY(device);
+
+    QCOMPARE(device->read(4096), m_content.left(4096));
+    const quint32 restarts = device->restartCount();
+
+    const qint64 far = 20 * 1024 * 1024 + 7;
+    QVERIFY(device->seek(far));
+    const qint64 fetchedBefore = device->bytesFetched();
+    QCOMPARE(device->read(300000), m_content.mid(far, 300000));
+    QCOMPARE(device->restartCount(), restarts + 1);
+
+    // Once the rest of the file is in, the half chunk before the seek target is fetched too
+    const qint64 behind = 512 * 1024;
+    QTRY_COMPARE(device->bytesFetched(), fetchedBefore + (FILE_SIZE - far) + behind);
+
+    // and serves a demuxer stepping back without another restart
+    const qint64 back = far - 1000;
+    QVERIFY(device->seek(back));
+    QCOMPARE(device->read(2000), m_content.mid(back, 2000));
+    QCOMPARE(device->restartCount(), restarts + 1);
+
+    QVERIFY(device->seek(17));
+    QCOMPARE(device->read(100000), m_content.mid(17, 100000));
+    QVERIFY(device->restartCount() > restarts + 1);
+}
+
+void TestReadAheadDevice::shortReadsAtEnd()
+{
+    std::unique_ptr<ReadAheadDevice> device(openDevice(0));
+    QVERIFY(device);
+
+    QVERIFY(device->seek(FILE_SIZE - 100));
+    QVERIFY(!device->atEnd());
+
+    const QByteArray tail = device->read(4096);
+    QCOMPARE(tail.size(), qsizetype(100));
+    QVERIFY(tail == m_content.right(100));
+    QVERIFY(device->atEnd());
+
+    char byte = 0;
+    QCOMPARE(device->read(&byte, 1), qint64(0));
+}
+
+void TestReadAheadDevice::stallsAreCounted()
+{
+    const int latencyMs = 50;
+    std::unique_ptr<ReadAheadDevice> device(openDevice(latencyMs));
+    QVERIFY(device);
+    QSignalSpy stalls(device.get(), &ReadAheadDevice::stalled);
+
+    // Nothing can be buffered yet, the first read waits for the upstream latency
+    QCOMPARE(device->read(1024), m_content.left(1024));
+    QCOMPARE(device->stallCount(), quint32(1));
+    QCOMPARE(stalls.size(), qsizetype(1));
+    QVERIFY(device->stallTimeUs() >= (latencyMs - 10) * 1000);
+
+    // Reading inside what is already buffered does not wait
+    QCOMPARE(device->read(1024), m_content.mid(1024, 1024));
+    QCOMPARE(device->stallCount(), quint32(1));
+
+    // Neither does a jump ahead into what the I/O thread has fetched since
+    QTRY_VERIFY(device->bytesFetched() >= 4 * 1024 * 1024);
+    QVERIFY(device->seek(3 * 1024 * 1024));
+    QCOMPARE(device->read(1024), m_content.mid(3 * 1024 * 1024, 1024));
+    QCOMPARE(device->stallCount(), quint32(1));
+    QCOMPARE(stalls.size(), qsizetype(1));
+}
+
+QTEST_GUILESS_MAIN(TestReadAheadDevice)
+#include "tst_readaheaddevice.moc"
@@ -0,0 +1,64 @@
+#include <QtTest>
+#include <cmath>
+#include "realfft.h"
+
+class TestRealFft : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void matchesDirectTransform();
+    void benchmarkPowerSpectrum();
+
+private:
+    // The frame size the spectrum analyzer runs
+    static constexpr int FRAME_SIZE = 2048;
+
+    std::vector<float> m_signal;
+};
+
+void TestRealFft::initTestCase()
+{
+    m_signal.resize(FRAME_SIZE);
+    for (int i = 0; i < FRAME_SIZE; ++i) {
+        m_signal[i] = float(std::sin(0.1 * i) + 0.5 * std::sin(0.37 * i) + 0.1);
+    }
+}
+
+void TestRealFft::matchesDirectTransform()
+{
+    RealFft fft(FRAME_SIZE);
+    std::vector<float> power(FRAME_SIZE / 2);
+    fft.powerSpectrum(m_signal.data(), power.data());
+
+    const double pi = 3.14159265358979323846;
+    for (int k = 0; k < FRAME_SIZE / 2; ++k) {
+        double re = 0;
+        double im = 0;
+        for (int n = 0; n < FRAME_SIZE; ++n) {
+            const double angle = 2 * pi * k * n / FRAME_SIZE;
+            re += m_signal[n] * std::cos(angle);
+            im -= m_signal[n] * std::sin(angle);
+        }
+
+        const double expected = re * re + im * im;
+        QVERIFY2(std::abs(power[k] - expected) <= 1e-3 * (1 + expected),
+                 qPrintable(QStringLiteral("bin %1: %2 vs %3").arg(k).arg(power[k]).arg(expected)));
+    }
+}
+
+void TestRealFft::benchmarkPowerSpectrum()
+{
+    // One analysis step of the visualizer, which runs at most 60 of them per second
+    RealFft fft(FRAME_SIZE);
+    std::vector<float> power(FRAME_SIZE / 2);
+
+    QBENCHMARK {
+        fft.powerSpectrum(m_signal.data(), power.data());
+    }
+}
+
+QTEST_MAIN(TestRealFft)
+#include "tst_realfft.moc"